@@ -0,0 +1,308 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Hook throughput benchmark.
+ *
+ * Feeds synthetic input through the real VPADRead/WPADRead hook bodies, and reports the
+ * cost per sample of the Turbiine logic, for every controller type and turbo state.
+ * The "remapped" state is the "turbo" state, with two buttons swapped by a remap; the
+ * "synced" state is the "turbo" state, with all buttons sharing the controller's beat.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <vector>
+
+#include "cfg.hpp"
+#include "snapshot.hpp"
+#include "vpad.hpp"
+#include "worker.hpp"
+#include "wpad.hpp"
+
+#include "driver.hpp"
+#include "stub/host_stub.hpp"
+
+
+using std::uint64_t;
+
+
+// Count every heap allocation made while the hooks run.
+namespace {
+    std::atomic<uint64_t> allocations = 0;
+}
+
+
+void*
+operator new(std::size_t size)
+{
+    ++allocations;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+
+void
+operator delete(void* p)
+    noexcept
+{
+    std::free(p);
+}
+
+
+void
+operator delete(void* p,
+                std::size_t)
+    noexcept
+{
+    std::free(p);
+}
+
+
+namespace {
+
+    using namespace driver;
+
+
+    enum class state {
+        idle,
+        toggling,
+        turbo,
+        remapped,
+        synced,
+        suppressed,
+    };
+
+
+    const char*
+    to_string(state s)
+    {
+        switch (s) {
+        case state::idle:       return "idle";
+        case state::toggling:   return "toggling";
+        case state::turbo:      return "turbo";
+        case state::remapped:   return "remapped";
+        case state::synced:     return "synced";
+        case state::suppressed: return "suppressed";
+        }
+        return "?";
+    }
+
+
+    struct result {
+        double ns_per_sample;
+        double allocs_per_sample;
+        double notifications_per_sample;
+    };
+
+
+    wups::utils::button_combo
+    to_combo(family f,
+             const input& in)
+    {
+        namespace utils = wups::utils;
+        if (f == family::vpad) {
+            utils::vpad::button_set bs;
+            bs.buttons = in.core;
+            return bs;
+        }
+        utils::wpad::button_set bs;
+        bs.core.buttons = in.core;
+        if (f == family::classic) {
+            utils::wpad::classic::button_set x;
+            x.buttons = in.ext;
+            bs.ext = x;
+        } else if (f == family::pro) {
+            utils::wpad::pro::button_set x;
+            x.buttons = in.ext;
+            bs.ext = x;
+        }
+        return bs;
+    }
+
+
+    // Swap the last two buttons of the family, or remove all remaps.
+    void
+    set_remap(family f,
+              const family_info& info,
+              bool on)
+    {
+        cfg::remaps = {};
+        if (on) {
+            const auto a = to_combo(f, info.buttons[info.buttons.size() - 2]);
+            const auto b = to_combo(f, info.buttons.back());
+            cfg::remaps[0] = {a, b};
+            cfg::remaps[1] = {b, a};
+        }
+        snapshot::publish();
+    }
+
+
+    result
+    run(family f,
+        state s,
+        uint64_t samples)
+    {
+        const family_info info = make_family_info(f);
+
+        vpad::reset();
+        wpad::reset();
+        select_family(f);
+        cfg::turbo_sync = s == state::synced ? 1 : 0;
+        set_remap(f, info, s == state::remapped);
+
+        // Start from a clean input state.
+        feed(f, {});
+        feed(f, {});
+
+        std::function<input(uint64_t)> gen;
+
+        switch (s) {
+
+        case state::idle:
+            gen = [](uint64_t) { return input{}; };
+            break;
+
+        case state::toggling:
+            // Each cycle of 4 samples enters the toggling state and toggles one button.
+            gen = [&info](uint64_t i) -> input
+            {
+                switch (i % 4) {
+                case 0:
+                    return info.combo;
+                case 2:
+                    return info.buttons[(i / 4) % info.buttons.size()];
+                default:
+                    return {};
+                }
+            };
+            break;
+
+        case state::turbo:
+        case state::remapped:
+        case state::synced:
+            // Turbinate all buttons, then hold them all down.
+            for (const auto& b : info.buttons)
+                toggle(f, info, b);
+            gen = [&info](uint64_t) { return info.all; };
+            break;
+
+        case state::suppressed:
+            // Hold all buttons, then activate the combo; all buttons stay suppressed.
+            feed(f, info.all);
+            gen = [&info](uint64_t) { return input{info.all.core | info.combo.core,
+                                                   info.all.ext | info.combo.ext}; };
+            feed(f, gen(0));
+            break;
+
+        }
+
+        // Generate the input beforehand, so only the hook is measured.
+        std::vector<input> inputs(samples);
+        for (uint64_t i = 0; i < samples; ++i)
+            inputs[i] = gen(i);
+
+        const uint64_t allocs_start = allocations;
+        const uint64_t notifications_start = host_stub::notifications;
+        auto t0 = std::chrono::steady_clock::now();
+
+        for (const auto& in : inputs)
+            feed(f, in);
+
+        auto t1 = std::chrono::steady_clock::now();
+        const uint64_t allocs = allocations - allocs_start;
+        const uint64_t notifications = host_stub::notifications - notifications_start;
+
+        std::chrono::duration<double, std::nano> elapsed = t1 - t0;
+        return {
+            elapsed.count() / samples,
+            double(allocs) / samples,
+            double(notifications) / samples
+        };
+    }
+
+
+    // Measure the stubbed real_*Read() alone, to subtract it from the results.
+    double
+    baseline(family f,
+             uint64_t samples)
+    {
+        select_family(f);
+        auto t0 = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < samples; ++i) {
+            if (f == family::vpad) {
+                VPADStatus buf;
+                VPADReadError error;
+                vpad::real_VPADRead(VPAD_CHAN_0, &buf, 1, &error);
+            } else {
+                wpad_buffer buf;
+                wpad::real_WPADRead(WPAD_CHAN_0, &buf.core);
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        std::chrono::duration<double, std::nano> elapsed = t1 - t0;
+        return elapsed.count() / samples;
+    }
+
+} // namespace
+
+
+int
+main(int argc,
+     char* argv[])
+{
+    const unsigned runs = 3;
+    uint64_t samples = 1'000'000;
+    if (argc > 1)
+        samples = std::strtoull(argv[1], nullptr, 10);
+    if (!samples) {
+        std::fprintf(stderr, "Usage: %s [samples]\n", argv[0]);
+        return 1;
+    }
+
+    driver::install();
+
+    // Notifications and logs are handled by their own thread, like on the console.
+    worker::initialize();
+
+    std::printf("# %llu samples per run, best of %u runs, period = %d\n",
+                static_cast<unsigned long long>(samples),
+                runs,
+                cfg::period);
+    std::printf("%-8s %-11s %12s %14s %14s\n",
+                "pad", "state", "ns/sample", "allocs/sample", "notify/sample");
+
+    for (auto f : {family::vpad, family::core, family::nunchuk,
+                   family::classic, family::pro}) {
+        const double base = baseline(f, samples);
+        for (auto s : {state::idle, state::toggling, state::turbo, state::remapped,
+                       state::synced, state::suppressed}) {
+            // Keep the fastest of a few runs, to filter out noise from the host OS.
+            auto r = run(f, s, samples);
+            for (unsigned i = 1; i < runs; ++i) {
+                auto r2 = run(f, s, samples);
+                if (r2.ns_per_sample < r.ns_per_sample)
+                    r = r2;
+            }
+            std::printf("%-8s %-11s %12.2f %14.3f %14.3f\n",
+                        to_string(f),
+                        to_string(s),
+                        r.ns_per_sample - base,
+                        r.allocs_per_sample,
+                        r.notifications_per_sample);
+        }
+    }
+
+    worker::finalize();
+}
@@ -0,0 +1,117 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include "capture_reader.hpp"
+
+
+using std::uint8_t;
+using std::uint32_t;
+using std::uint64_t;
+
+
+namespace capture_reader {
+
+    namespace {
+
+        template<unsigned N>
+        uint64_t
+        get_le(const uint8_t* src)
+        {
+            uint64_t value = 0;
+            for (unsigned i = 0; i < N; ++i)
+                value |= uint64_t{src[i]} << (8 * i);
+            return value;
+        }
+
+    } // namespace
+
+
+    bool
+    load(const char* filename,
+         contents& c)
+    {
+        namespace format = capture::format;
+
+        std::FILE* f = std::fopen(filename, "rb");
+        if (!f) {
+            std::perror(filename);
+            return false;
+        }
+        std::vector<uint8_t> data;
+        for (int ch; (ch = std::fgetc(f)) != EOF;)
+            data.push_back(ch);
+        std::fclose(f);
+
+        if (data.size() < format::header_size
+            || std::memcmp(data.data(), format::magic, sizeof format::magic)) {
+            std::fprintf(stderr, "%s: not a capture file\n", filename);
+            return false;
+        }
+        if (data[4] != format::version) {
+            std::fprintf(stderr, "%s: capture format version %u, expected %u\n",
+                         filename, data[4], format::version);
+            return false;
+        }
+        c.num_streams      = data[5];
+        c.ticks_per_second = get_le<4>(&data[8]);
+        c.title_id         = get_le<8>(&data[12]);
+        c.records.clear();
+
+        std::size_t pos = format::header_size;
+        auto varint = [&]() -> uint32_t
+        {
+            uint32_t value = 0;
+            for (unsigned shift = 0; pos < data.size() && shift < 35; shift += 7) {
+                const uint8_t b = data[pos++];
+                value |= uint32_t(b & 0x7f) << shift;
+                if (!(b & 0x80))
+                    break;
+            }
+            return value;
+        };
+
+        std::vector<capture::sample> last(c.num_streams);
+        std::vector<uint64_t> time(c.num_streams);
+        while (pos + 2 <= data.size()) {
+            const unsigned stream = data[pos++];
+            const uint8_t fields = data[pos++];
+            if (stream >= c.num_streams) {
+                std::fprintf(stderr, "%s: bad stream %u\n", filename, stream);
+                return false;
+            }
+            capture::sample& s = last[stream];
+            record r{};
+            r.stream = stream;
+            r.dt = varint();
+            time[stream] += r.dt;
+            s.time += r.dt;
+            r.time = time[stream];
+            r.gap = fields & format::gap ? varint() : 0;
+            if (fields & format::raw_core)
+                s.raw_core ^= varint();
+            if (fields & format::raw_ext)
+                s.raw_ext ^= varint();
+            if (fields & format::out_core)
+                s.out_core ^= varint();
+            if (fields & format::out_ext)
+                s.out_ext ^= varint();
+            if (fields & format::family)
+                s.family = static_cast<notify::pad>(static_cast<uint8_t>(s.family)
+                                                    ^ varint());
+            s.first = fields & format::first;
+            s.loose = fields & format::loose;
+            r.sample = s;
+            c.records.push_back(r);
+        }
+        return true;
+    }
+
+} // namespace capture_reader
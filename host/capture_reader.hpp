@@ -0,0 +1,48 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Decoder for the capture files written by "Capture input to SD card", shared by the host
+ * programs. The format is described in capture.hpp.
+ */
+
+#ifndef CAPTURE_READER_HPP
+#define CAPTURE_READER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "capture.hpp"
+
+
+namespace capture_reader {
+
+    // One record, with the fields of its stream after applying it.
+    struct record {
+        unsigned        stream;
+        std::uint32_t   dt;     // ticks since the previous sample of this stream
+        std::uint64_t   time;   // ticks since the start of this stream, doesn't wrap
+        std::uint32_t   gap;    // samples dropped before this one
+        capture::sample sample;
+    };
+
+
+    struct contents {
+        unsigned            num_streams      = 0;
+        std::uint32_t       ticks_per_second = 0;
+        std::uint64_t       title_id         = 0;
+        std::vector<record> records;
+    };
+
+
+    // Read and decode the whole file; on error, prints it to stderr and returns false.
+    bool load(const char* filename, contents& c);
+
+} // namespace capture_reader
+
+#endif
@@ -0,0 +1,571 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <coreinit/title.h>
+
+#include "capture.hpp"
+#include "cfg.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "vpad.hpp"
+#include "watchdog.hpp"
+#include "wpad.hpp"
+
+#include "capture_reader.hpp"
+#include "checks.hpp"
+#include "driver.hpp"
+#include "stub/host_stub.hpp"
+
+
+using std::uint32_t;
+using std::uint64_t;
+
+using namespace driver;
+
+namespace fs = std::filesystem;
+namespace utils = wups::utils;
+
+
+namespace checks {
+
+    namespace {
+
+        // Failures of the check being run.
+        std::vector<std::string> failures;
+
+
+        void
+        expect(bool ok,
+               const std::string& what)
+        {
+            if (!ok)
+                failures.push_back(what);
+        }
+
+
+        std::string
+        hex(uint32_t value)
+        {
+            char buf[16];
+            std::snprintf(buf, sizeof buf, "%08x", value);
+            return buf;
+        }
+
+
+        void
+        start()
+        {
+            vpad::reset();
+            wpad::reset();
+            host_stub::vpad_proc_mode[0] = 1;
+            select_ext_type(WPAD_EXT_CORE);
+        }
+
+
+        // Feed these VPAD samples, oldest first, "per_read" at a time; returns what the
+        // game got, in the same order.
+        std::vector<VPADStatus>
+        feed_reads(const std::vector<uint32_t>& samples,
+                   unsigned per_read)
+        {
+            std::vector<VPADStatus> result;
+            std::vector<VPADStatus> out;
+            for (std::size_t i = 0; i < samples.size(); i += per_read) {
+                const auto last = std::min(samples.size(), i + per_read);
+                feed_vpad({samples.begin() + i, samples.begin() + last}, out);
+                result.insert(result.end(), out.begin(), out.end());
+            }
+            return result;
+        }
+
+
+        // Compare what the game got to the expected buttons, with the edges a real
+        // VPADRead() would give: per sample in tight mode, accumulated over the read in
+        // loose mode. "prev" is what the game got before; only the buttons in "mask" are
+        // compared.
+        void
+        expect_vpad(const std::vector<VPADStatus>& got,
+                    const std::vector<uint32_t>& holds,
+                    uint32_t prev,
+                    unsigned per_read,
+                    uint32_t mask,
+                    const char* what)
+        {
+            const bool loose = !host_stub::vpad_proc_mode[0];
+            expect(got.size() == holds.size(), std::string{what} + ": wrong sample count");
+            uint32_t trigger = 0;
+            uint32_t release = 0;
+            for (std::size_t i = 0; i < std::min(got.size(), holds.size()); ++i) {
+                if (!loose || i % per_read == 0)
+                    trigger = release = 0;
+                trigger |= holds[i] & ~prev;
+                release |= prev & ~holds[i];
+                prev = holds[i];
+                const uint32_t hold = got[i].hold & mask;
+                const uint32_t trig = got[i].trigger & mask;
+                const uint32_t rel  = got[i].release & mask;
+                expect(hold == holds[i] && trig == trigger && rel == release,
+                       std::string{what} + ", sample " + std::to_string(i)
+                       + ": got " + hex(hold) + "/" + hex(trig) + "/" + hex(rel)
+                       + ", expected " + hex(holds[i]) + "/" + hex(trigger)
+                       + "/" + hex(release));
+            }
+        }
+
+
+        void
+        use_macro_combos()
+        {
+            cfg::record_combo = utils::vpad::button_set{VPAD_BUTTON_STICK_L};
+            cfg::play_combo   = utils::vpad::button_set{VPAD_BUTTON_STICK_R};
+            snapshot::publish();
+        }
+
+
+        void
+        use_wpad_macro_combos()
+        {
+            cfg::record_combo = utils::wpad::button_set{
+                utils::wpad::core::button_set{WPAD_BUTTON_1}};
+            cfg::play_combo = utils::wpad::button_set{
+                utils::wpad::core::button_set{WPAD_BUTTON_2}};
+            snapshot::publish();
+        }
+
+
+        // Record a VPAD macro, then play it while a button is held across its end: the
+        // game must get the macro, then nothing until that button is pressed again.
+        void
+        vpad_macro(bool loose)
+        {
+            start();
+            host_stub::vpad_proc_mode[0] = !loose;
+            use_macro_combos();
+
+            const unsigned per_read = 3;
+            const uint32_t A = VPAD_BUTTON_A;
+            const uint32_t B = VPAD_BUTTON_B;
+            const uint32_t X = VPAD_BUTTON_X;
+            const std::vector<uint32_t> tape = {A, A, A | B, B, 0, X, X, X};
+
+            feed_reads({0, 0}, per_read);
+            feed_reads({VPAD_BUTTON_STICK_L}, per_read);
+            feed_reads(tape, per_read);
+            feed_reads({VPAD_BUTTON_STICK_L, 0}, per_read);
+
+            feed_reads({VPAD_BUTTON_STICK_R}, per_read);
+            // The macro, the sample that releases it, then B is held, released and pressed.
+            std::vector<uint32_t> real(tape.size() + 3, B);
+            real.insert(real.end(), {0, B});
+            std::vector<uint32_t> expected = tape;
+            expected.insert(expected.end(), {0, 0, 0, 0, B});
+            expect_vpad(feed_reads(real, per_read), expected, 0, per_read, A | B | X,
+                        "playback");
+
+            // It plays again, from the start.
+            feed_reads({0, VPAD_BUTTON_STICK_R}, per_read);
+            std::vector<uint32_t> idle(tape.size() + 1, 0);
+            expected = tape;
+            expected.push_back(0);
+            expect_vpad(feed_reads(idle, per_read), expected, 0, per_read, A | B | X,
+                        "replay");
+        }
+
+
+        // Record a macro with a nunchuk, then swap the extension in the middle of playing it.
+        void
+        wpad_macro_hotswap()
+        {
+            start();
+            select_ext_type(WPAD_EXT_NUNCHUK);
+            use_wpad_macro_combos();
+
+            const input A = {WPAD_BUTTON_A};
+            const input B = {WPAD_BUTTON_B};
+            const input Z = {WPAD_NUNCHUK_BUTTON_Z};
+            const input AZ = {A.core | Z.core};
+            const std::vector<input> tape = {A, A, AZ, Z, {}, B, B};
+
+            auto run = [](const std::vector<input>& real,
+                          const std::vector<input>& expected,
+                          const char* what)
+            {
+                for (std::size_t i = 0; i < real.size(); ++i) {
+                    const auto out = feed(family::nunchuk, real[i]);
+                    expect(out.hold.core == expected[i].core,
+                           std::string{what} + ", sample " + std::to_string(i)
+                           + ": got " + hex(out.hold.core)
+                           + ", expected " + hex(expected[i].core));
+                }
+            };
+
+            feed(family::nunchuk, {});
+            feed(family::nunchuk, {WPAD_BUTTON_1});
+            for (const auto& in : tape)
+                feed(family::nunchuk, in);
+            feed(family::nunchuk, {WPAD_BUTTON_1});
+            feed(family::nunchuk, {});
+
+            // Swapping the extension stops the macro; A was never seen pressed, so it stays
+            // hidden until it's pressed again.
+            feed(family::nunchuk, {WPAD_BUTTON_2});
+            run({A, A, A}, {tape[0], tape[1], tape[2]}, "before the swap");
+            select_ext_type(WPAD_EXT_CORE);
+            run({A, A, {}, A}, {{}, {}, {}, A}, "after the swap");
+
+            // With another extension, there's nothing to play.
+            feed(family::core, {WPAD_BUTTON_2});
+            run({{}, B}, {{}, B}, "wrong extension");
+
+            // Back to the nunchuk, the whole macro plays; Z is held across its end.
+            select_ext_type(WPAD_EXT_NUNCHUK);
+            feed(family::nunchuk, {});
+            feed(family::nunchuk, {WPAD_BUTTON_2});
+            std::vector<input> real(tape.size() + 3, Z);
+            real.insert(real.end(), {{}, Z});
+            std::vector<input> expected = tape;
+            expected.insert(expected.end(), {{}, {}, {}, {}, Z});
+            run(real, expected, "playback");
+        }
+
+
+        // Remap A to X; the game must get X with its own edges, and never A.
+        void
+        vpad_remap(bool loose)
+        {
+            start();
+            host_stub::vpad_proc_mode[0] = !loose;
+            cfg::remaps = {};
+            cfg::remaps[0] = {utils::vpad::button_set{VPAD_BUTTON_A},
+                              utils::vpad::button_set{VPAD_BUTTON_X}};
+            snapshot::publish();
+
+            const unsigned per_read = 3;
+            const uint32_t A = VPAD_BUTTON_A;
+            const uint32_t B = VPAD_BUTTON_B;
+            const uint32_t X = VPAD_BUTTON_X;
+            const std::vector<uint32_t> real     = {0, A, A, A | B, B, 0, A, A, 0};
+            const std::vector<uint32_t> expected = {0, X, X, X | B, B, 0, X, X, 0};
+            expect_vpad(feed_reads(real, per_read), expected, 0, per_read, A | B | X,
+                        "remap");
+
+            // The WPAD has its own table.
+            select_family(family::core);
+            cfg::remaps[1] = {
+                utils::wpad::button_set{utils::wpad::core::button_set{WPAD_BUTTON_A}},
+                utils::wpad::button_set{utils::wpad::core::button_set{WPAD_BUTTON_B}}
+            };
+            snapshot::publish();
+            const uint32_t wa = WPAD_BUTTON_A;
+            const uint32_t wb = WPAD_BUTTON_B;
+            const uint32_t wpad_real[]     = {0, wa, wa | wb, wb, 0};
+            const uint32_t wpad_expected[] = {0, wb, wb,      wb, 0};
+            for (unsigned i = 0; i < std::size(wpad_real); ++i) {
+                const auto out = feed(family::core, {wpad_real[i]});
+                expect(out.hold.core == wpad_expected[i],
+                       "wpad remap, sample " + std::to_string(i) + ": got "
+                       + hex(out.hold.core) + ", expected " + hex(wpad_expected[i]));
+            }
+        }
+
+
+        // Push the left stick around, past the threshold and back; the game must get the
+        // D-pad, with its edges.
+        void
+        vpad_stick_dpad(bool loose)
+        {
+            start();
+            host_stub::vpad_proc_mode[0] = !loose;
+            cfg::remaps = {};
+            cfg::left_stick_dpad = 50;
+            snapshot::publish();
+
+            const uint32_t up    = VPAD_BUTTON_UP;
+            const uint32_t down  = VPAD_BUTTON_DOWN;
+            const uint32_t left  = VPAD_BUTTON_LEFT;
+            const uint32_t right = VPAD_BUTTON_RIGHT;
+            const struct {
+                VPADVec2D stick;
+                uint32_t  dpad;   // also pressed on the real D-pad
+                uint32_t  expected;
+            } samples[] = {
+                {{0.0f, 0.0f},   0,     0},
+                {{0.6f, 0.0f},   0,     right},
+                {{0.7f, 0.2f},   0,     right},
+                {{0.4f, 0.0f},   0,     0},
+                {{-0.6f, 0.6f},  0,     left | up},
+                {{0.0f, -0.9f},  0,     down},
+                {{0.0f, -0.9f},  down,  down},
+                {{0.0f, 0.0f},   down,  down},
+                {{0.0f, 0.0f},   0,     0},
+            };
+
+            // One sample per read, since the stick is the same for every sample of a read.
+            std::vector<VPADStatus> got;
+            std::vector<uint32_t> expected;
+            for (const auto& smp : samples) {
+                set_vpad_sticks(smp.stick, {});
+                std::vector<VPADStatus> out;
+                feed_vpad({smp.dpad}, out);
+                got.insert(got.end(), out.begin(), out.end());
+                expected.push_back(smp.expected);
+            }
+            set_vpad_sticks({}, {});
+            expect_vpad(got, expected, 0, 1, up | down | left | right, "stick");
+        }
+
+
+        // Make every call go over the time budget: after a few of them, the game must get
+        // the input untouched; a second later, within the budget again, it's processed
+        // again.
+        void
+        vpad_watchdog()
+        {
+            start();
+            cfg::remaps = {};
+            cfg::remaps[0] = {utils::vpad::button_set{VPAD_BUTTON_A},
+                              utils::vpad::button_set{VPAD_BUTTON_X}};
+            cfg::time_budget = 1;
+            snapshot::publish();
+
+            const uint32_t A = VPAD_BUTTON_A;
+            const uint32_t X = VPAD_BUTTON_X;
+            const auto& counters = vpad::get_stats(0);
+            const uint32_t degraded = counters.degraded.load();
+            const uint32_t skipped  = counters.skipped.load();
+
+            host_stub::fake_time = 1'000;
+            host_stub::tick_step = OSTimerClockSpeed / 1000; // 1 ms per call
+
+            auto run = [](const std::vector<uint32_t>& real,
+                          const std::vector<uint32_t>& expected,
+                          const char* what)
+            {
+                const auto got = feed_reads(real, 1);
+                for (std::size_t i = 0; i < std::min(got.size(), expected.size()); ++i)
+                    expect((got[i].hold & (A | X)) == expected[i],
+                           std::string{what} + ", sample " + std::to_string(i) + ": got "
+                           + hex(got[i].hold & (A | X)) + ", expected "
+                           + hex(expected[i]));
+            };
+
+            std::vector<uint32_t> real(watchdog::max_overruns, A);
+            real.insert(real.end(), {A, A, 0, A});
+            std::vector<uint32_t> expected(watchdog::max_overruns, X);
+            expected.insert(expected.end(), {A, A, 0, A});
+            run(real, expected, "over the budget");
+            expect(counters.degraded.load() == degraded + 1, "not degraded once");
+            expect(counters.skipped.load() == skipped + 4, "wrong number of calls skipped");
+
+            // Until the second is over, the input is left alone, even within the budget.
+            host_stub::tick_step = 0;
+            run({A}, {A}, "before the retry");
+
+            host_stub::fake_time += OSTimerClockSpeed;
+            run({A, A, 0, A}, {X, X, 0, X}, "after the retry");
+            expect(counters.degraded.load() == degraded + 1, "degraded again");
+
+            host_stub::fake_time = -1;
+        }
+
+
+        // Capture VPAD reads in both modes, and WPAD samples from every family, with some
+        // dropped; then decode the file: every sample must come back as the hook saw it.
+        void
+        capture_roundtrip()
+        {
+            start();
+
+            // The capture file goes in the current directory; don't overwrite one there.
+            char dir[] = "/tmp/turbiine-checks-XXXXXX";
+            if (!mkdtemp(dir)) {
+                expect(false, "could not create a temporary directory");
+                return;
+            }
+            const fs::path prev_dir = fs::current_path();
+            fs::current_path(dir);
+
+            cfg::capture = true;
+            snapshot::publish();
+
+            const unsigned vpad_stream = 0;
+            const unsigned wpad_stream = vpad::max_vpads;
+            std::vector<capture::sample> expected[vpad::max_vpads + wpad::max_wpads];
+            uint64_t now = 1'000;
+
+            auto vpad_read = [&](const std::vector<uint32_t>& holds, bool loose)
+            {
+                host_stub::vpad_proc_mode[0] = !loose;
+                host_stub::fake_time = now += 3'000;
+                std::vector<VPADStatus> out;
+                feed_vpad(holds, out);
+                for (std::size_t i = 0; i < out.size(); ++i)
+                    expected[vpad_stream].push_back({
+                            static_cast<uint32_t>(now), holds[i], 0, out[i].hold, 0,
+                            notify::pad::vpad, i == 0, loose
+                        });
+            };
+
+            auto wpad_read = [&](family f, notify::pad source, const input& in)
+            {
+                host_stub::fake_time = now += 1'000'000;
+                const output out = feed(f, in);
+                expected[wpad_stream].push_back({
+                        static_cast<uint32_t>(now), in.core, in.ext,
+                        out.hold.core, out.hold.ext, source, true, false
+                    });
+            };
+
+            const uint32_t A = VPAD_BUTTON_A;
+            const uint32_t B = VPAD_BUTTON_B;
+            vpad_read({A, A | B, B}, true);
+            vpad_read({0}, true);
+            vpad_read({B, 0, A, A}, false);
+            vpad_read({A}, false);
+
+            // The ticks wrap around here.
+            now = 0xffff'0000;
+            const struct {
+                family      f;
+                notify::pad source;
+                input       in;
+            } wpads[] = {
+                {family::core,    notify::pad::wpad_core,    {WPAD_BUTTON_A}},
+                {family::nunchuk, notify::pad::wpad_nunchuk, {WPAD_NUNCHUK_BUTTON_Z}},
+                {family::classic, notify::pad::wpad_classic, {0, WPAD_CLASSIC_BUTTON_Y}},
+                {family::pro,     notify::pad::wpad_pro,     {0, WPAD_PRO_BUTTON_B}},
+            };
+            for (const auto& w : wpads) {
+                select_family(w.f);
+                wpad_read(w.f, w.source, {});
+                wpad_read(w.f, w.source, w.in);
+                wpad_read(w.f, w.source, {});
+            }
+
+            // Fill both halves of the WPAD buffer without the worker taking them; the
+            // samples that don't fit are dropped, and the next one says how many.
+            select_family(family::core);
+            const unsigned kept = 2 * 128 - expected[wpad_stream].size();
+            const unsigned dropped = 50;
+            for (unsigned i = 0; i < kept; ++i)
+                wpad_read(family::core, notify::pad::wpad_core,
+                          {i & 1 ? uint32_t{WPAD_BUTTON_B} : 0});
+            for (unsigned i = 0; i < dropped; ++i)
+                feed(family::core, {});
+            capture::flush();
+            wpad_read(family::core, notify::pad::wpad_core, {WPAD_BUTTON_1});
+            capture::finish();
+
+            cfg::capture = false;
+            snapshot::publish();
+            host_stub::fake_time = -1;
+
+            char name[64];
+            std::snprintf(name, sizeof name, "turbiine-capture-%016llx.bin",
+                          static_cast<unsigned long long>(OSGetTitleID()));
+            capture_reader::contents c;
+            if (!capture_reader::load(name, c))
+                expect(false, "could not read the capture file");
+            fs::current_path(prev_dir);
+            fs::remove_all(dir);
+
+            expect(c.num_streams == std::size(expected), "wrong number of streams");
+            expect(c.ticks_per_second == OSTimerClockSpeed, "wrong ticks per second");
+            expect(c.title_id == OSGetTitleID(), "wrong title ID");
+
+            std::vector<std::size_t> next(c.num_streams);
+            for (const auto& r : c.records) {
+                if (r.stream >= std::size(expected)
+                    || next[r.stream] >= expected[r.stream].size()) {
+                    expect(false, "extra record in stream " + std::to_string(r.stream));
+                    continue;
+                }
+                const std::size_t i = next[r.stream]++;
+                const capture::sample& e = expected[r.stream][i];
+                const capture::sample& g = r.sample;
+                const std::string what = "stream " + std::to_string(r.stream)
+                                       + ", sample " + std::to_string(i);
+                expect(g.time == e.time, what + ": wrong time");
+                expect(g.raw_core == e.raw_core && g.raw_ext == e.raw_ext
+                       && g.out_core == e.out_core && g.out_ext == e.out_ext,
+                       what + ": wrong buttons");
+                expect(g.family == e.family, what + ": wrong family");
+                expect(g.first == e.first && g.loose == e.loose, what + ": wrong flags");
+                const bool after_drop = r.stream == wpad_stream
+                                        && i + 1 == expected[r.stream].size();
+                expect(r.gap == (after_drop ? dropped : 0), what + ": wrong gap");
+            }
+            for (unsigned stream = 0; stream < std::size(expected); ++stream)
+                expect(next[stream] == expected[stream].size(),
+                       "missing records in stream " + std::to_string(stream));
+        }
+
+
+        struct check {
+            const char* name;
+            void (*run)();
+        };
+
+
+        const check all_checks[] = {
+            {"vpad-macro-tight", [] { vpad_macro(false); }},
+            {"vpad-macro-loose", [] { vpad_macro(true); }},
+            {"wpad-macro-hotswap", wpad_macro_hotswap},
+            {"vpad-remap-tight", [] { vpad_remap(false); }},
+            {"vpad-remap-loose", [] { vpad_remap(true); }},
+            {"vpad-stick-dpad-tight", [] { vpad_stick_dpad(false); }},
+            {"vpad-stick-dpad-loose", [] { vpad_stick_dpad(true); }},
+            {"vpad-watchdog", vpad_watchdog},
+            {"capture-roundtrip", capture_roundtrip},
+        };
+
+    } // namespace
+
+
+    bool
+    run()
+    {
+        const auto saved_record = cfg::record_combo;
+        const auto saved_play   = cfg::play_combo;
+        const auto saved_remaps = cfg::remaps;
+        const int saved_left_stick = cfg::left_stick_dpad;
+        const int saved_budget     = cfg::time_budget;
+
+        bool ok = true;
+        for (const auto& c : all_checks) {
+            failures.clear();
+            c.run();
+            std::printf("%-24s %s\n", c.name, failures.empty() ? "ok" : "FAILED");
+            for (const auto& f : failures)
+                std::printf("    %s\n", f.c_str());
+            if (!failures.empty())
+                ok = false;
+        }
+
+        cfg::record_combo = saved_record;
+        cfg::play_combo   = saved_play;
+        cfg::remaps       = saved_remaps;
+        cfg::left_stick_dpad = saved_left_stick;
+        cfg::time_budget     = saved_budget;
+        snapshot::publish();
+        vpad::reset();
+        wpad::reset();
+        host_stub::vpad_proc_mode[0] = 0;
+        select_ext_type(WPAD_EXT_CORE);
+        return ok;
+    }
+
+} // namespace checks
@@ -0,0 +1,28 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Behavior checks for the host programs.
+ *
+ * Unlike the golden hashes, these say what the game must get: short scripted sequences are
+ * fed through the real hook bodies, and every sample the game gets is compared to the
+ * expected one.
+ */
+
+#ifndef CHECKS_HPP
+#define CHECKS_HPP
+
+
+namespace checks {
+
+    // Run every check, printing one line for each; returns false if any failed.
+    bool run();
+
+} // namespace checks
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "driver.hpp"
+
+#include "cfg.hpp"
+#include "hooks.hpp"
+#include "snapshot.hpp"
+
+
+using std::int32_t;
+using std::uint32_t;
+
+namespace utils = wups::utils;
+
+
+namespace driver {
+
+    const char*
+    to_string(family f)
+    {
+        switch (f) {
+        case family::vpad:    return "vpad";
+        case family::core:    return "core";
+        case family::nunchuk: return "nunchuk";
+        case family::classic: return "classic";
+        case family::pro:     return "pro";
+        }
+        return "?";
+    }
+
+
+    family_info
+    make_family_info(family f)
+    {
+        family_info info;
+
+        auto add_core = [&info](std::initializer_list<uint32_t> list)
+        {
+            for (auto b : list) {
+                info.all.core |= b;
+                info.buttons.push_back({b, 0});
+            }
+        };
+
+        auto add_ext = [&info](std::initializer_list<uint32_t> list)
+        {
+            for (auto b : list) {
+                info.all.ext |= b;
+                info.buttons.push_back({0, b});
+            }
+        };
+
+        switch (f) {
+
+        case family::vpad:
+            add_core({VPAD_BUTTON_A, VPAD_BUTTON_B, VPAD_BUTTON_X, VPAD_BUTTON_Y,
+                      VPAD_BUTTON_LEFT, VPAD_BUTTON_RIGHT, VPAD_BUTTON_UP, VPAD_BUTTON_DOWN,
+                      VPAD_BUTTON_L, VPAD_BUTTON_ZL, VPAD_BUTTON_R, VPAD_BUTTON_ZR,
+                      VPAD_BUTTON_PLUS, VPAD_BUTTON_MINUS});
+            info.combo.core = VPAD_BUTTON_TV;
+            break;
+
+        case family::nunchuk:
+            add_core({WPAD_NUNCHUK_BUTTON_Z, WPAD_NUNCHUK_BUTTON_C});
+            [[fallthrough]];
+
+        case family::core:
+            add_core({WPAD_BUTTON_LEFT, WPAD_BUTTON_RIGHT, WPAD_BUTTON_DOWN, WPAD_BUTTON_UP,
+                      WPAD_BUTTON_PLUS, WPAD_BUTTON_2, WPAD_BUTTON_1, WPAD_BUTTON_B,
+                      WPAD_BUTTON_A, WPAD_BUTTON_MINUS});
+            info.combo.core = WPAD_BUTTON_HOME;
+            break;
+
+        case family::classic:
+            add_core({WPAD_BUTTON_LEFT, WPAD_BUTTON_RIGHT, WPAD_BUTTON_DOWN, WPAD_BUTTON_UP,
+                      WPAD_BUTTON_PLUS, WPAD_BUTTON_2, WPAD_BUTTON_1, WPAD_BUTTON_B,
+                      WPAD_BUTTON_A, WPAD_BUTTON_MINUS});
+            add_ext({WPAD_CLASSIC_BUTTON_UP, WPAD_CLASSIC_BUTTON_LEFT, WPAD_CLASSIC_BUTTON_ZR,
+                     WPAD_CLASSIC_BUTTON_X, WPAD_CLASSIC_BUTTON_A, WPAD_CLASSIC_BUTTON_Y,
+                     WPAD_CLASSIC_BUTTON_B, WPAD_CLASSIC_BUTTON_ZL, WPAD_CLASSIC_BUTTON_R,
+                     WPAD_CLASSIC_BUTTON_PLUS, WPAD_CLASSIC_BUTTON_MINUS,
+                     WPAD_CLASSIC_BUTTON_L, WPAD_CLASSIC_BUTTON_DOWN,
+                     WPAD_CLASSIC_BUTTON_RIGHT});
+            info.combo.ext = WPAD_CLASSIC_BUTTON_HOME;
+            break;
+
+        case family::pro:
+            add_ext({WPAD_PRO_BUTTON_UP, WPAD_PRO_BUTTON_LEFT, WPAD_PRO_TRIGGER_ZR,
+                     WPAD_PRO_BUTTON_X, WPAD_PRO_BUTTON_A, WPAD_PRO_BUTTON_Y,
+                     WPAD_PRO_BUTTON_B, WPAD_PRO_TRIGGER_ZL, WPAD_PRO_TRIGGER_R,
+                     WPAD_PRO_BUTTON_PLUS, WPAD_PRO_BUTTON_MINUS, WPAD_PRO_TRIGGER_L,
+                     WPAD_PRO_BUTTON_DOWN, WPAD_PRO_BUTTON_RIGHT});
+            info.combo.ext = WPAD_PRO_BUTTON_HOME;
+            break;
+
+        }
+
+        return info;
+    }
+
+
+    // The fake controllers: the stubbed real_*Read() functions return this.
+    input current_input;
+
+
+    // Like the real VPADRead(), the edges are computed against the previous sample.
+    uint32_t fake_vpad_prev_hold = 0;
+
+    // When not empty, the samples for the next VPADRead(), oldest first.
+    const std::vector<uint32_t>* fake_vpad_samples = nullptr;
+
+    VPADVec2D fake_vpad_left_stick  = {};
+    VPADVec2D fake_vpad_right_stick = {};
+
+
+    int32_t
+    fake_VPADRead(VPADChan channel,
+                  VPADStatus* buf,
+                  uint32_t count,
+                  VPADReadError* error)
+    {
+        if (fake_vpad_samples) {
+            // In loose mode, the edges are everything since the last read.
+            const bool is_loose = !VPADGetButtonProcMode(channel);
+            uint32_t trigger = 0;
+            uint32_t release = 0;
+            // Note: buf[0] is the newest sample.
+            const auto& samples = *fake_vpad_samples;
+            count = std::min<uint32_t>(count, samples.size());
+            for (uint32_t i = 0; i < count; ++i) {
+                VPADStatus& status = buf[count - 1 - i];
+                std::memset(&status, 0, sizeof status);
+                status.leftStick  = fake_vpad_left_stick;
+                status.rightStick = fake_vpad_right_stick;
+                status.hold    = samples[i];
+                status.trigger = status.hold & ~fake_vpad_prev_hold;
+                status.release = fake_vpad_prev_hold & ~status.hold;
+                fake_vpad_prev_hold = status.hold;
+                if (is_loose) {
+                    trigger |= status.trigger;
+                    release |= status.release;
+                    status.trigger = trigger;
+                    status.release = release;
+                }
+            }
+            if (error)
+                *error = VPAD_READ_SUCCESS;
+            return count;
+        }
+
+        // Note: buf[0] is the newest sample; all samples here have the same buttons.
+        for (uint32_t i = 0; i < count; ++i) {
+            std::memset(&buf[i], 0, sizeof buf[i]);
+            buf[i].leftStick  = fake_vpad_left_stick;
+            buf[i].rightStick = fake_vpad_right_stick;
+            buf[i].hold = current_input.core;
+        }
+        if (count) {
+            VPADStatus& oldest = buf[count - 1];
+            oldest.trigger = oldest.hold & ~fake_vpad_prev_hold;
+            oldest.release = fake_vpad_prev_hold & ~oldest.hold;
+            fake_vpad_prev_hold = oldest.hold;
+        }
+        if (error)
+            *error = VPAD_READ_SUCCESS;
+        return count;
+    }
+
+
+    WPADExtensionType fake_ext_type = WPAD_EXT_CORE;
+
+
+    void
+    fake_WPADRead(WPADChan,
+                  WPADStatus* status)
+    {
+        switch (fake_ext_type) {
+
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            {
+                auto xstatus = reinterpret_cast<WPADClassicStatus*>(status);
+                std::memset(xstatus, 0, sizeof *xstatus);
+                xstatus->ext.buttons = current_input.ext;
+            }
+            break;
+
+        case WPAD_EXT_PRO_CONTROLLER:
+            {
+                auto xstatus = reinterpret_cast<WPADProStatus*>(status);
+                std::memset(xstatus, 0, sizeof *xstatus);
+                xstatus->ext.buttons = current_input.ext;
+            }
+            break;
+
+        default:
+            std::memset(status, 0, sizeof(WPADNunchukStatus));
+
+        }
+
+        status->buttons = current_input.core;
+        status->extensionType = fake_ext_type;
+    }
+
+
+    void
+    install()
+    {
+        vpad::real_VPADRead = fake_VPADRead;
+        wpad::real_WPADRead = fake_WPADRead;
+
+        cfg::toggle_combo = {
+            utils::vpad::button_set{VPAD_BUTTON_TV},
+            utils::wpad::button_set{utils::wpad::core::button_set{WPAD_BUTTON_HOME}},
+            utils::wpad::button_set{utils::wpad::classic::button_set{WPAD_CLASSIC_BUTTON_HOME}},
+            utils::wpad::button_set{utils::wpad::pro::button_set{WPAD_PRO_BUTTON_HOME}}
+        };
+        snapshot::publish();
+        hooks::update();
+    }
+
+
+    void
+    select_family(family f)
+    {
+        switch (f) {
+        case family::vpad:    break;
+        case family::core:    fake_ext_type = WPAD_EXT_CORE;           break;
+        case family::nunchuk: fake_ext_type = WPAD_EXT_NUNCHUK;        break;
+        case family::classic: fake_ext_type = WPAD_EXT_CLASSIC;        break;
+        case family::pro:     fake_ext_type = WPAD_EXT_PRO_CONTROLLER; break;
+        }
+    }
+
+
+    void
+    select_ext_type(WPADExtensionType ext_type)
+    {
+        fake_ext_type = ext_type;
+    }
+
+
+    void
+    set_vpad_sticks(const VPADVec2D& left,
+                    const VPADVec2D& right)
+    {
+        fake_vpad_left_stick  = left;
+        fake_vpad_right_stick = right;
+    }
+
+
+    output
+    feed(family f,
+         const input& in)
+    {
+        current_input = in;
+        if (f == family::vpad) {
+            VPADStatus buf;
+            VPADReadError error;
+            vpad::my_VPADRead(VPAD_CHAN_0, &buf, 1, &error);
+            return {{buf.hold, 0}, buf.trigger};
+        }
+
+        wpad_buffer buf;
+        wpad::my_WPADRead(WPAD_CHAN_0, &buf.core);
+        switch (buf.core.extensionType) {
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            return {{buf.classic.core.buttons, buf.classic.ext.buttons}};
+        case WPAD_EXT_PRO_CONTROLLER:
+            return {{0, buf.pro.ext.buttons}};
+        default:
+            return {{buf.core.buttons, 0}};
+        }
+    }
+
+
+    void
+    feed_vpad(const std::vector<uint32_t>& holds,
+              std::vector<VPADStatus>& out)
+    {
+        out.resize(holds.size());
+        fake_vpad_samples = &holds;
+        VPADReadError error;
+        const int32_t n = vpad::my_VPADRead(VPAD_CHAN_0, out.data(), out.size(), &error);
+        fake_vpad_samples = nullptr;
+        out.resize(n);
+        std::ranges::reverse(out);
+    }
+
+
+    void
+    toggle(family f,
+           const family_info& info,
+           const input& button)
+    {
+        feed(f, info.combo);
+        feed(f, {});
+        feed(f, button);
+        feed(f, {});
+    }
+
+} // namespace driver
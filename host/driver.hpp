@@ -0,0 +1,118 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Fake controllers for the host programs.
+ *
+ * The stubbed real_VPADRead()/real_WPADRead() return whatever input is set here, so
+ * samples can be fed through the real hook bodies.
+ */
+
+#ifndef DRIVER_HPP
+#define DRIVER_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include <padscore/wpad.h>
+#include <vpad/input.h>
+
+#include <wupsxx/../../src/wpad_status.h>
+
+
+// The hook bodies, as defined by DECL_FUNCTION().
+namespace vpad {
+    extern std::int32_t (*real_VPADRead)(VPADChan, VPADStatus*, std::uint32_t, VPADReadError*);
+    std::int32_t my_VPADRead(VPADChan, VPADStatus*, std::uint32_t, VPADReadError*)
+        noexcept;
+}
+
+namespace wpad {
+    extern void (*real_WPADRead)(WPADChan, WPADStatus*);
+    void my_WPADRead(WPADChan, WPADStatus*) noexcept;
+}
+
+
+namespace driver {
+
+    enum class family {
+        vpad,
+        core,
+        nunchuk,
+        classic,
+        pro,
+    };
+
+
+    const char* to_string(family f);
+
+
+    // Raw button state of one sample; "ext" is only used by classic and pro.
+    struct input {
+        std::uint32_t core = 0;
+        std::uint32_t ext  = 0;
+    };
+
+
+    // What the game got from one sample.
+    struct output {
+        input         hold;
+        std::uint32_t trigger = 0; // only for vpad
+    };
+
+
+    // All buttons that can be turbinated, and a toggle combo that doesn't overlap them.
+    struct family_info {
+        input all;
+        input combo;
+        std::vector<input> buttons;
+    };
+
+
+    family_info make_family_info(family f);
+
+
+    // Large enough for any extension.
+    union wpad_buffer {
+        WPADStatus        core;
+        WPADNunchukStatus nunchuk;
+        WPADClassicStatus classic;
+        WPADProStatus     pro;
+    };
+
+
+    // Install the fake controllers, and use the toggle combos from make_family_info().
+    void install();
+
+
+    // Pick the WPAD extension of a family, without the Motion Plus.
+    void select_family(family f);
+
+    // Pick any WPAD extension type.
+    void select_ext_type(WPADExtensionType ext_type);
+
+
+    // Where the VPAD sticks are in every sample from now on.
+    void set_vpad_sticks(const VPADVec2D& left, const VPADVec2D& right);
+
+
+    // Run one sample through the hook for this family.
+    output feed(family f, const input& in);
+
+    // Run one VPADRead() that returns all these samples at once, oldest first; "out" gets
+    // what the game got, in the same order.
+    void feed_vpad(const std::vector<std::uint32_t>& holds,
+                   std::vector<VPADStatus>& out);
+
+
+    // Press and release the toggle combo, then press and release the button.
+    void toggle(family f, const family_info& info, const input& button);
+
+} // namespace driver
+
+#endif
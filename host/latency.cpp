@@ -0,0 +1,188 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * First press latency check.
+ *
+ * With "Immediate first press" enabled, a turbo button must reach the game on the same
+ * sample it's pressed, and keep the first press for a whole step. This feeds presses of
+ * random lengths through the real hook bodies, for every controller type and extension,
+ * and fails if any press is delayed.
+ */
+
+#include <coreinit/time.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "cfg.hpp"
+#include "snapshot.hpp"
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+#include "driver.hpp"
+#include "stub/host_stub.hpp"
+
+
+using std::uint32_t;
+
+using namespace driver;
+
+
+namespace {
+
+    struct target {
+        const char*       name;
+        family            fam;
+        WPADExtensionType ext_type;
+    };
+
+
+    const target targets[] = {
+        {"vpad",          family::vpad,    WPAD_EXT_CORE},
+        {"core",          family::core,    WPAD_EXT_CORE},
+        {"nunchuk",       family::nunchuk, WPAD_EXT_NUNCHUK},
+        {"classic",       family::classic, WPAD_EXT_CLASSIC},
+        {"pro",           family::pro,     WPAD_EXT_PRO_CONTROLLER},
+        {"mplus",         family::core,    WPAD_EXT_MPLUS},
+        {"mplus+nunchuk", family::nunchuk, WPAD_EXT_MPLUS_NUNCHUK},
+        {"mplus+classic", family::classic, WPAD_EXT_MPLUS_CLASSIC},
+    };
+
+
+    struct timing {
+        int period;
+        int rate;
+    };
+
+
+    const timing timings[] = {
+        {1, 0},
+        {2, 0},
+        {3, 0},
+        {7, 0},
+        {1, 10},
+        {1, 30},
+    };
+
+
+    // Samples per second, when using the rate.
+    const int sample_rate = 60;
+
+
+    // Small deterministic generator, so failures can be reproduced.
+    uint32_t seed = 1;
+
+    unsigned
+    random(unsigned lo,
+           unsigned hi)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return lo + (seed >> 16) % (hi - lo + 1);
+    }
+
+
+    bool
+    shown(const output& out,
+          const input& button)
+    {
+        return (out.hold.core & button.core) || (out.hold.ext & button.ext);
+    }
+
+
+    struct tally {
+        unsigned presses = 0;
+        unsigned late    = 0; // presses not shown on the sample they happened
+        unsigned short_  = 0; // first presses that didn't last a whole step
+    };
+
+
+    output
+    step(family f,
+         const input& in)
+    {
+        host_stub::fake_time += OSTimerClockSpeed / sample_rate;
+        return feed(f, in);
+    }
+
+
+    void
+    check(const target& t,
+          const timing& tm,
+          tally& st)
+    {
+        const auto info = make_family_info(t.fam);
+        cfg::period = tm.period;
+        cfg::rate   = tm.rate;
+        snapshot::publish();
+
+        // Samples in one step.
+        const unsigned step_len = tm.rate
+                                  ? sample_rate / (2 * tm.rate)
+                                  : tm.period;
+
+        for (const auto& button : info.buttons) {
+            vpad::reset();
+            wpad::reset();
+            select_ext_type(t.ext_type);
+            step(t.fam, {});
+            step(t.fam, {});
+            toggle(t.fam, info, button);
+
+            for (unsigned i = 0; i < 20; ++i) {
+                for (unsigned gap = random(1, 5); gap; --gap)
+                    step(t.fam, {});
+
+                const unsigned held = random(1, 4 * step_len);
+                ++st.presses;
+                for (unsigned n = 0; n < held; ++n) {
+                    const auto out = step(t.fam, button);
+                    if (n == 0) {
+                        const bool triggered = t.fam != family::vpad
+                                               || (out.trigger & button.core);
+                        if (!shown(out, button) || !triggered)
+                            ++st.late;
+                    } else if (n < step_len && !shown(out, button)) {
+                        ++st.short_;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace
+
+
+int
+main()
+{
+    install();
+    host_stub::fake_time = 0;
+
+    cfg::immediate = true;
+    snapshot::publish();
+
+    std::printf("%-14s %6s %4s %8s %6s %6s\n",
+                "pad", "period", "rate", "presses", "late", "short");
+
+    bool ok = true;
+    for (const auto& t : targets)
+        for (const auto& tm : timings) {
+            tally st;
+            check(t, tm, st);
+            std::printf("%-14s %6d %4d %8u %6u %6u\n",
+                        t.name, tm.period, tm.rate, st.presses, st.late, st.short_);
+            if (st.late || st.short_)
+                ok = false;
+        }
+
+    std::printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
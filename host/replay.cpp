@@ -0,0 +1,621 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Trace replay harness.
+ *
+ * Feeds input traces through the real VPADRead/WPADRead hook bodies, hashes everything the
+ * game gets, and compares the hashes to a golden file; so a change to the turbo logic can
+ * be proven bit-identical before it's deployed. It also reports the throughput, in samples
+ * per second. The behavior checks from checks.hpp run first.
+ *
+ * The traces are either synthetic, generated from a fixed seed for every controller type,
+ * or captured on the console with "Capture input to SD card".
+ *
+ *   turbiine-replay [-n samples] [-g golden] [-w]
+ *   turbiine-replay [-s config] -c capture.bin
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <coreinit/time.h>
+
+#include "capture.hpp"
+#include "cfg.hpp"
+#include "snapshot.hpp"
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+#include "capture_reader.hpp"
+#include "checks.hpp"
+#include "driver.hpp"
+#include "stub/host_stub.hpp"
+
+
+using std::uint32_t;
+using std::uint64_t;
+
+using namespace driver;
+
+namespace utils = wups::utils;
+
+
+namespace {
+
+    // One read by the game: a few samples for VPAD, one sample for WPAD.
+    struct read {
+        uint64_t          time;     // ticks
+        uint32_t          first;    // index of the first sample
+        std::uint16_t     count;
+        bool              is_vpad;
+        bool              loose;    // VPAD button proc mode
+        WPADExtensionType ext_type; // only for WPAD
+    };
+
+
+    struct trace {
+        std::vector<read>  reads;
+        std::vector<input> samples;
+        std::vector<input> expected; // only for captures: what the game got on the console
+        unsigned           warmup = 0; // reads not hashed
+    };
+
+
+    // FNV-1a, over every word the game gets.
+    struct hasher {
+        uint64_t value = 0xcbf29ce484222325;
+
+        void
+        add(uint32_t word)
+            noexcept
+        {
+            for (unsigned i = 0; i < 4; ++i) {
+                value ^= (word >> (8 * i)) & 0xff;
+                value *= 0x100000001b3;
+            }
+        }
+    };
+
+
+    // Settings that change the output; the golden file has one hash for each.
+    struct config {
+        const char* name;
+        int         period;
+        int         rate;
+        bool        immediate;
+        bool        patterns;
+        int         sync = 0;
+    };
+
+
+    const config configs[] = {
+        {"period1",   1,  0, false, false},
+        {"period3",   3,  0, false, false},
+        {"rate10",    1, 10, false, false},
+        {"immediate", 1, 15, true,  false},
+        {"patterns",  2,  0, false, true},
+        {"sync-pad",  2,  0, false, true,  1},
+        {"sync-all",  1, 10, false, false, 2},
+    };
+
+
+    void
+    apply(const config& c)
+    {
+        cfg::period     = c.period;
+        cfg::rate       = c.rate;
+        cfg::immediate  = c.immediate;
+        cfg::turbo_sync = c.sync;
+        cfg::patterns   = {};
+        if (c.patterns) {
+            cfg::patterns[0] = {
+                utils::vpad::button_set{VPAD_BUTTON_A, VPAD_BUTTON_B},
+                5, 2, 3, 0
+            };
+            cfg::patterns[1] = {
+                utils::wpad::button_set{utils::wpad::core::button_set{WPAD_BUTTON_A,
+                                                                      WPAD_BUTTON_1}},
+                4, 3, 0, 1
+            };
+            cfg::patterns[2] = {
+                utils::wpad::button_set{utils::wpad::classic::button_set{
+                        WPAD_CLASSIC_BUTTON_A}},
+                3, 1, 2, 0
+            };
+        }
+        snapshot::publish();
+    }
+
+
+    enum class source {
+        vpad,          // one sample per read
+        vpad_buffered, // up to 16 samples per read, tight mode
+        vpad_loose,    // up to 16 samples per read, loose mode
+        core,
+        nunchuk,
+        classic,
+        pro,
+        hotswap,       // WPAD, the extension changes every few seconds
+    };
+
+
+    struct scenario {
+        const char* name;
+        source      src;
+    };
+
+
+    const scenario scenarios[] = {
+        {"vpad",          source::vpad},
+        {"vpad-buffered", source::vpad_buffered},
+        {"vpad-loose",    source::vpad_loose},
+        {"core",          source::core},
+        {"nunchuk",       source::nunchuk},
+        {"classic",       source::classic},
+        {"pro",           source::pro},
+        {"hotswap",       source::hotswap},
+    };
+
+
+    // Small deterministic generator, so the traces are the same everywhere.
+    struct rng {
+        uint32_t seed;
+
+        unsigned
+        operator ()(unsigned n)
+            noexcept
+        {
+            seed = seed * 1664525 + 1013904223;
+            return (seed >> 8) % n;
+        }
+    };
+
+
+    family
+    family_of(WPADExtensionType ext_type)
+    {
+        switch (ext_type) {
+        case WPAD_EXT_NUNCHUK:
+        case WPAD_EXT_MPLUS_NUNCHUK:
+            return family::nunchuk;
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            return family::classic;
+        case WPAD_EXT_PRO_CONTROLLER:
+            return family::pro;
+        default:
+            return family::core;
+        }
+    }
+
+
+    /*
+     * Buttons change at random, a few times per second; once in a while the toggle combo
+     * is pressed, followed by a button, so the turbo buttons change too.
+     */
+    trace
+    generate(source src,
+             uint64_t num_samples)
+    {
+        trace t;
+        rng random{static_cast<uint32_t>(src) * 7919 + 1};
+
+        const bool is_vpad = src == source::vpad
+                             || src == source::vpad_buffered
+                             || src == source::vpad_loose;
+
+        static const WPADExtensionType ext_types[] = {
+            WPAD_EXT_CORE,
+            WPAD_EXT_NUNCHUK,
+            WPAD_EXT_CLASSIC,
+            WPAD_EXT_PRO_CONTROLLER,
+            WPAD_EXT_MPLUS,
+            WPAD_EXT_MPLUS_NUNCHUK,
+            WPAD_EXT_MPLUS_CLASSIC,
+        };
+
+        WPADExtensionType ext_type = WPAD_EXT_CORE;
+        switch (src) {
+        case source::nunchuk: ext_type = WPAD_EXT_NUNCHUK;        break;
+        case source::classic: ext_type = WPAD_EXT_CLASSIC;        break;
+        case source::pro:     ext_type = WPAD_EXT_PRO_CONTROLLER; break;
+        default:              break;
+        }
+
+        family_info info = make_family_info(is_vpad ? family::vpad : family_of(ext_type));
+
+        const uint64_t read_interval = OSTimerClockSpeed / (is_vpad ? 60 : 200);
+        uint64_t time = OSTimerClockSpeed;
+        input held;
+        std::vector<input> queued; // toggle sequence being typed, in reverse order
+        unsigned next_swap = 1000;
+
+        t.samples.reserve(num_samples + 2);
+        t.reads.reserve(num_samples + 2);
+
+        auto add_read = [&](unsigned count)
+        {
+            t.reads.push_back({
+                    .time     = time,
+                    .first    = static_cast<uint32_t>(t.samples.size()),
+                    .count    = static_cast<std::uint16_t>(count),
+                    .is_vpad  = is_vpad,
+                    .loose    = src == source::vpad_loose,
+                    .ext_type = ext_type
+                });
+            time += read_interval;
+        };
+
+        // Start from a clean input state.
+        for (unsigned i = 0; i < 2; ++i) {
+            add_read(1);
+            t.samples.push_back({});
+        }
+        t.warmup = 2;
+
+        while (t.samples.size() < num_samples + t.warmup) {
+
+            if (src == source::hotswap && !--next_swap) {
+                next_swap = 200 + random(2000);
+                ext_type = ext_types[random(std::size(ext_types))];
+                info = make_family_info(family_of(ext_type));
+                held = {};
+                queued.clear();
+            }
+
+            unsigned count = 1;
+            if (src == source::vpad_buffered || src == source::vpad_loose)
+                count = 1 + random(16);
+            const uint64_t left = num_samples + t.warmup - t.samples.size();
+            if (count > left)
+                count = left;
+
+            add_read(count);
+            for (unsigned i = 0; i < count; ++i) {
+                input in;
+                if (!queued.empty()) {
+                    in = queued.back();
+                    queued.pop_back();
+                } else {
+                    const unsigned r = random(1000);
+                    if (r < 2) {
+                        // Toggle some button.
+                        const input& btn = info.buttons[random(info.buttons.size())];
+                        queued = {{}, btn, {}};
+                        held = {};
+                        in = info.combo;
+                    } else {
+                        if (r < 120) {
+                            const input& btn = info.buttons[random(info.buttons.size())];
+                            held.core ^= btn.core;
+                            held.ext  ^= btn.ext;
+                        }
+                        in = held;
+                    }
+                }
+                t.samples.push_back(in);
+            }
+        }
+
+        return t;
+    }
+
+
+    WPADExtensionType
+    ext_type_of(notify::pad f)
+    {
+        switch (f) {
+        case notify::pad::wpad_nunchuk: return WPAD_EXT_NUNCHUK;
+        case notify::pad::wpad_classic: return WPAD_EXT_CLASSIC;
+        case notify::pad::wpad_pro:     return WPAD_EXT_PRO_CONTROLLER;
+        default:                        return WPAD_EXT_CORE;
+        }
+    }
+
+
+    // Load one channel from a capture file, with the reads the game did.
+    void
+    load_capture(const capture_reader::contents& c,
+                 unsigned wanted,
+                 trace& t)
+    {
+        for (const auto& r : c.records) {
+            if (r.stream != wanted)
+                continue;
+            const capture::sample& s = r.sample;
+            const bool is_vpad = s.family == notify::pad::vpad;
+            if (!s.first && !t.reads.empty() && t.reads.back().count < 16)
+                ++t.reads.back().count;
+            else
+                t.reads.push_back({
+                        .time     = r.time,
+                        .first    = static_cast<uint32_t>(t.samples.size()),
+                        .count    = 1,
+                        .is_vpad  = is_vpad,
+                        .loose    = s.loose,
+                        .ext_type = ext_type_of(s.family)
+                    });
+            t.samples.push_back({s.raw_core, s.raw_ext});
+            t.expected.push_back({s.out_core, s.out_ext});
+        }
+    }
+
+
+    struct result {
+        uint64_t hash       = 0;
+        uint64_t samples    = 0;
+        uint64_t mismatches = 0; // against trace::expected
+        double   seconds    = 0;
+    };
+
+
+    result
+    replay(const trace& t)
+    {
+        vpad::reset();
+        wpad::reset();
+
+        result res;
+        hasher h;
+        std::vector<uint32_t> holds;
+        std::vector<VPADStatus> statuses;
+        holds.reserve(16);
+        statuses.reserve(16);
+
+        auto check = [&](uint32_t idx, const input& got)
+        {
+            if (idx < t.expected.size()
+                && (got.core != t.expected[idx].core || got.ext != t.expected[idx].ext))
+                ++res.mismatches;
+        };
+
+        const auto t0 = std::chrono::steady_clock::now();
+
+        for (std::size_t r = 0; r < t.reads.size(); ++r) {
+            const read& rd = t.reads[r];
+            const bool hashed = r >= t.warmup;
+            host_stub::fake_time = rd.time;
+
+            if (rd.is_vpad) {
+                host_stub::vpad_proc_mode[0] = !rd.loose;
+                holds.clear();
+                for (unsigned i = 0; i < rd.count; ++i)
+                    holds.push_back(t.samples[rd.first + i].core);
+                feed_vpad(holds, statuses);
+                for (unsigned i = 0; i < statuses.size(); ++i) {
+                    const VPADStatus& st = statuses[i];
+                    if (hashed) {
+                        h.add(st.hold);
+                        h.add(st.trigger);
+                        h.add(st.release);
+                        ++res.samples;
+                    }
+                    check(rd.first + i, {st.hold, 0});
+                }
+            } else {
+                select_ext_type(rd.ext_type);
+                const output out = feed(family::core, t.samples[rd.first]);
+                if (hashed) {
+                    h.add(rd.ext_type);
+                    h.add(out.hold.core);
+                    h.add(out.hold.ext);
+                    ++res.samples;
+                }
+                check(rd.first, out.hold);
+            }
+        }
+
+        const auto t1 = std::chrono::steady_clock::now();
+        res.seconds = std::chrono::duration<double>(t1 - t0).count();
+        res.hash = h.value;
+        return res;
+    }
+
+
+    using golden_map = std::map<std::string, std::string>;
+
+
+    golden_map
+    read_golden(const char* filename)
+    {
+        golden_map result;
+        std::FILE* f = std::fopen(filename, "r");
+        if (!f)
+            return result;
+        char line[256];
+        while (std::fgets(line, sizeof line, f)) {
+            if (line[0] == '#')
+                continue;
+            char name[64], conf[64], samples[32], hash[32];
+            if (std::sscanf(line, "%63s %63s %31s %31s", name, conf, samples, hash) == 4)
+                result[std::string{name} + " " + conf + " " + samples] = hash;
+        }
+        std::fclose(f);
+        return result;
+    }
+
+
+    std::string
+    to_hex(uint64_t value)
+    {
+        char buf[17];
+        std::snprintf(buf, sizeof buf, "%016llx", static_cast<unsigned long long>(value));
+        return buf;
+    }
+
+
+    int
+    usage(const char* argv0)
+    {
+        std::fprintf(stderr,
+                     "Usage: %s [-n samples] [-g golden] [-w]\n"
+                     "       %s [-s config] -c capture.bin\n",
+                     argv0, argv0);
+        return 1;
+    }
+
+
+    int
+    run_capture(const char* filename,
+                const config& conf)
+    {
+        capture_reader::contents c;
+        if (!capture_reader::load(filename, c))
+            return 1;
+
+        apply(conf);
+        std::printf("# %s, config %s\n", filename, conf.name);
+        std::printf("%-8s %10s %12s %10s  %-16s\n",
+                    "channel", "samples", "samples/s", "differ", "hash");
+
+        for (unsigned channel = 0; channel < vpad::max_vpads + wpad::max_wpads; ++channel) {
+            trace t;
+            load_capture(c, channel, t);
+            if (t.samples.empty())
+                continue;
+            const result r = replay(t);
+            char name[16];
+            if (channel < vpad::max_vpads)
+                std::snprintf(name, sizeof name, "vpad %u", channel);
+            else
+                std::snprintf(name, sizeof name, "wpad %u", channel - vpad::max_vpads);
+            std::printf("%-8s %10llu %12.0f %10llu  %s\n",
+                        name,
+                        static_cast<unsigned long long>(r.samples),
+                        r.samples / r.seconds,
+                        static_cast<unsigned long long>(r.mismatches),
+                        to_hex(r.hash).c_str());
+        }
+        return 0;
+    }
+
+} // namespace
+
+
+int
+main(int argc,
+     char* argv[])
+{
+    uint64_t samples = 1'000'000;
+    const char* golden_file = "golden/replay.txt";
+    const char* capture_file = nullptr;
+    const char* config_name = "period1";
+    bool write = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-w")
+            write = true;
+        else if (i + 1 == argc)
+            return usage(argv[0]);
+        else if (arg == "-n")
+            samples = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "-g")
+            golden_file = argv[++i];
+        else if (arg == "-c")
+            capture_file = argv[++i];
+        else if (arg == "-s")
+            config_name = argv[++i];
+        else
+            return usage(argv[0]);
+    }
+    if (!samples)
+        return usage(argv[0]);
+
+    // Captures are replayed with the default toggle combos, like on the console.
+    const auto default_combos = cfg::toggle_combo;
+    install();
+
+    if (capture_file) {
+        for (const auto& c : configs)
+            if (c.name == std::string{config_name}) {
+                cfg::toggle_combo = default_combos;
+                snapshot::publish();
+                return run_capture(capture_file, c);
+            }
+        std::fprintf(stderr, "Unknown config \"%s\".\n", config_name);
+        return 1;
+    }
+
+    std::printf("# checks\n");
+    const bool checked = checks::run();
+
+    const golden_map golden = read_golden(golden_file);
+    std::FILE* out = nullptr;
+    if (write) {
+        out = std::fopen(golden_file, "w");
+        if (!out) {
+            std::perror(golden_file);
+            return 1;
+        }
+        std::fprintf(out, "# turbiine-replay golden hashes: scenario config samples hash\n");
+    }
+
+    std::printf("# %llu samples per trace\n", static_cast<unsigned long long>(samples));
+    std::printf("%-14s %-10s %12s  %-16s  %s\n",
+                "trace", "config", "samples/s", "hash", "golden");
+
+    unsigned differ = 0;
+    unsigned missing = 0;
+    uint64_t total_samples = 0;
+    double total_seconds = 0;
+
+    for (const auto& sc : scenarios) {
+        const trace t = generate(sc.src, samples);
+        for (const auto& conf : configs) {
+            apply(conf);
+            const result r = replay(t);
+            total_samples += r.samples;
+            total_seconds += r.seconds;
+
+            const std::string key = std::string{sc.name} + " " + conf.name + " "
+                                    + std::to_string(samples);
+            const std::string hash = to_hex(r.hash);
+            const char* status = "new";
+            if (auto it = golden.find(key); it != golden.end()) {
+                status = it->second == hash ? "ok" : "DIFFERS";
+                if (it->second != hash)
+                    ++differ;
+            } else
+                ++missing;
+
+            std::printf("%-14s %-10s %12.0f  %s  %s\n",
+                        sc.name, conf.name, r.samples / r.seconds, hash.c_str(), status);
+            if (out)
+                std::fprintf(out, "%s %s\n", key.c_str(), hash.c_str());
+        }
+    }
+
+    std::printf("# total: %llu samples, %.0f samples/s\n",
+                static_cast<unsigned long long>(total_samples),
+                total_samples / total_seconds);
+
+    if (out) {
+        std::fclose(out);
+        std::printf("Wrote %s\n", golden_file);
+        return 0;
+    }
+    if (differ) {
+        std::printf("FAIL: %u traces differ from %s\n", differ, golden_file);
+        return 1;
+    }
+    if (!checked) {
+        std::printf("FAIL: some checks failed\n");
+        return 1;
+    }
+    if (missing)
+        std::printf("%u traces are not in %s\n", missing, golden_file);
+    std::printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host replacement for "src/cfg.cpp": same variables and defaults, no config menu and no
+ * storage. The plugin starts enabled here, since that's what the host programs measure.
+ */
+
+#include "cfg.hpp"
+
+#include "snapshot.hpp"
+
+
+using std::array;
+
+using namespace wups::utils;
+
+
+namespace cfg {
+
+    bool enabled = true;
+
+    int period = 1;
+
+    int rate = 0;
+
+    bool immediate = false;
+
+    int turbo_sync = 0;
+
+    bool remember_turbo = true;
+
+    bool remember_rate = false;
+
+    array<button_combo, max_toggle_combos> toggle_combo = {
+        vpad::button_set{VPAD_BUTTON_TV,
+                         VPAD_BUTTON_ZL},
+        wpad::button_set{wpad::core::button_set{WPAD_BUTTON_MINUS,
+                                                WPAD_BUTTON_PLUS,
+                                                WPAD_BUTTON_B}},
+        wpad::button_set{wpad::classic::button_set{WPAD_CLASSIC_BUTTON_DOWN,
+                                                   WPAD_CLASSIC_BUTTON_MINUS,
+                                                   WPAD_CLASSIC_BUTTON_ZL}},
+        wpad::button_set{wpad::pro::button_set{WPAD_PRO_BUTTON_DOWN,
+                                               WPAD_PRO_BUTTON_MINUS,
+                                               WPAD_PRO_TRIGGER_ZL}}
+    };
+
+    array<pattern, max_patterns> patterns;
+
+    button_combo record_combo;
+
+    button_combo play_combo;
+
+    bool capture = false;
+
+    array<button_remap, max_remaps> remaps;
+
+    int left_stick_dpad = 0;
+
+    int right_stick_dpad = 0;
+
+    int time_budget = 1000;
+
+
+    std::mutex storage_mutex;
+
+
+    void
+    init()
+    {
+        snapshot::publish();
+    }
+
+
+    void
+    touch()
+    {}
+
+
+    void
+    flush(bool)
+    {}
+
+} // namespace cfg
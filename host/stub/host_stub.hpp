@@ -0,0 +1,42 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Knobs and counters exposed by the host stubs, for the host programs.
+ */
+
+#ifndef HOST_STUB_HPP
+#define HOST_STUB_HPP
+
+#include <array>
+#include <cstdint>
+
+
+namespace host_stub {
+
+    // What VPADGetButtonProcMode() returns for each channel: 0 = loose, 1 = tight.
+    extern std::array<std::uint8_t, 2> vpad_proc_mode;
+
+    // How many times NotificationModule_AddInfoNotificationEx() was called.
+    extern std::uint64_t notifications;
+
+    // When not negative, what OSGetTime() returns; otherwise it follows the host clock.
+    extern std::int64_t fake_time;
+
+    // How much fake_time goes forward on every OSGetTime(), so the hooks see time passing.
+    extern std::int64_t tick_step;
+
+    // How many function patches are installed.
+    extern unsigned patches;
+
+    // How many times wups::logger::printf() was called.
+    extern std::uint64_t log_lines;
+
+} // namespace host_stub
+
+#endif
@@ -0,0 +1,7 @@
+/*
+ * Host stub for the Autotools-generated "config.h".
+ */
+
+#define PACKAGE_NAME "Turbiine"
+#define PACKAGE_TARNAME "turbiine"
+#define PACKAGE_VERSION "1.0"
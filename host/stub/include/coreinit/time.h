@@ -0,0 +1,53 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for WUT's <coreinit/time.h>.
+ *
+ * The ticks run at the same rate as on the Wii U, so tick arithmetic behaves the same.
+ */
+
+#ifndef HOST_STUB_COREINIT_TIME_H
+#define HOST_STUB_COREINIT_TIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef int32_t OSTick;
+typedef int64_t OSTime;
+
+
+#define OSTimerClockSpeed 62156250
+
+#define OSSecondsToTicks(val)        ((uint64_t)(val) * (uint64_t)OSTimerClockSpeed)
+#define OSMillisecondsToTicks(val)  (((uint64_t)(val) * (uint64_t)OSTimerClockSpeed) / 1000ull)
+#define OSMicrosecondsToTicks(val)  (((uint64_t)(val) * (uint64_t)OSTimerClockSpeed) / 1000000ull)
+
+#define OSTicksToSeconds(val)        ((uint64_t)(val) / (uint64_t)OSTimerClockSpeed)
+#define OSTicksToMilliseconds(val)  (((uint64_t)(val) * 1000ull) / (uint64_t)OSTimerClockSpeed)
+#define OSTicksToMicroseconds(val)  (((uint64_t)(val) * 1000000ull) / (uint64_t)OSTimerClockSpeed)
+
+
+OSTime OSGetTime(void);
+
+OSTime OSGetSystemTime(void);
+
+OSTick OSGetTick(void);
+
+OSTick OSGetSystemTick(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
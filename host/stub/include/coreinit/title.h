@@ -0,0 +1,30 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for WUT's <coreinit/title.h>.
+ */
+
+#ifndef HOST_STUB_COREINIT_TITLE_H
+#define HOST_STUB_COREINIT_TITLE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+uint64_t OSGetTitleID(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for libfunctionpatcher's <function_patcher/function_patching.h>.
+ *
+ * DECL_FUNCTION() expands the same way as in libfunctionpatcher: a "real_" function
+ * pointer, and a "my_" function with the hook body. The host program assigns the "real_"
+ * pointer itself, and calls the "my_" function directly; installing a patch only marks it
+ * as installed.
+ */
+
+#ifndef HOST_STUB_FUNCTION_PATCHER_FUNCTION_PATCHING_H
+#define HOST_STUB_FUNCTION_PATCHER_FUNCTION_PATCHING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+#define DECL_FUNCTION(res, name, ...)           \
+    res (*real_##name)(__VA_ARGS__);            \
+    res my_##name(__VA_ARGS__)
+
+
+typedef enum function_replacement_library_type_t {
+    LIBRARY_PADSCORE,
+    LIBRARY_VPAD,
+} function_replacement_library_type_t;
+
+
+typedef struct function_replacement_data_t {
+    struct {
+        function_replacement_library_type_t library;
+        const char* function_name;
+    } ReplaceInRPL;
+} function_replacement_data_t;
+
+
+// Note: the host programs call the hooks directly, so the addresses are not recorded.
+#define REPLACE_FUNCTION(x, lib, fname)                                 \
+    {                                                                   \
+        .ReplaceInRPL = { .library = lib, .function_name = #fname }     \
+    }
+
+
+typedef uint32_t PatchedFunctionHandle;
+
+
+typedef enum FunctionPatcherStatus {
+    FUNCTION_PATCHER_RESULT_SUCCESS = 0,
+    FUNCTION_PATCHER_RESULT_UNKNOWN_ERROR = -0x1000,
+} FunctionPatcherStatus;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+FunctionPatcherStatus FunctionPatcher_InitLibrary(void);
+
+FunctionPatcherStatus FunctionPatcher_DeInitLibrary(void);
+
+const char* FunctionPatcher_GetStatusStr(FunctionPatcherStatus status);
+
+FunctionPatcherStatus FunctionPatcher_AddFunctionPatch(function_replacement_data_t* function_data,
+                                                       PatchedFunctionHandle* outHandle,
+                                                       bool* outHasBeenPatched);
+
+FunctionPatcherStatus FunctionPatcher_RemoveFunctionPatch(PatchedFunctionHandle handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
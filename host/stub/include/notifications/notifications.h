@@ -0,0 +1,54 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for libnotifications' <notifications/notifications.h>.
+ */
+
+#ifndef HOST_STUB_NOTIFICATIONS_H
+#define HOST_STUB_NOTIFICATIONS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef enum NotificationModuleStatus {
+    NOTIFICATION_MODULE_RESULT_SUCCESS = 0,
+} NotificationModuleStatus;
+
+
+typedef struct NMColor {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} NMColor;
+
+
+typedef void (*NotificationModuleNotificationFinishedCallback)(void* handle, void* context);
+
+
+NotificationModuleStatus
+NotificationModule_AddInfoNotificationEx(const char* text,
+                                         float durationBeforeFadeOutInSeconds,
+                                         NMColor textColor,
+                                         NMColor backgroundColor,
+                                         NotificationModuleNotificationFinishedCallback callback,
+                                         void* callbackContext,
+                                         bool keepUntilShown);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,99 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for WUT's <vpad/input.h>.
+ *
+ * Only the parts used by Turbiine are declared; the layout of VPADStatus starts the same
+ * way as WUT's, the rest is not relevant for the host build.
+ */
+
+#ifndef HOST_STUB_VPAD_INPUT_H
+#define HOST_STUB_VPAD_INPUT_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef enum VPADButtons {
+    VPAD_BUTTON_SYNC                   = 0x00000001,
+    VPAD_BUTTON_HOME                   = 0x00000002,
+    VPAD_BUTTON_MINUS                  = 0x00000004,
+    VPAD_BUTTON_PLUS                   = 0x00000008,
+    VPAD_BUTTON_R                      = 0x00000010,
+    VPAD_BUTTON_L                      = 0x00000020,
+    VPAD_BUTTON_ZR                     = 0x00000040,
+    VPAD_BUTTON_ZL                     = 0x00000080,
+    VPAD_BUTTON_DOWN                   = 0x00000100,
+    VPAD_BUTTON_UP                     = 0x00000200,
+    VPAD_BUTTON_RIGHT                  = 0x00000400,
+    VPAD_BUTTON_LEFT                   = 0x00000800,
+    VPAD_BUTTON_Y                      = 0x00001000,
+    VPAD_BUTTON_X                      = 0x00002000,
+    VPAD_BUTTON_B                      = 0x00004000,
+    VPAD_BUTTON_A                      = 0x00008000,
+    VPAD_BUTTON_TV                     = 0x00010000,
+    VPAD_BUTTON_STICK_R                = 0x00020000,
+    VPAD_BUTTON_STICK_L                = 0x00040000,
+    VPAD_STICK_R_EMULATION_DOWN        = 0x00800000,
+    VPAD_STICK_R_EMULATION_UP          = 0x01000000,
+    VPAD_STICK_R_EMULATION_RIGHT       = 0x02000000,
+    VPAD_STICK_R_EMULATION_LEFT        = 0x04000000,
+    VPAD_STICK_L_EMULATION_DOWN        = 0x08000000,
+    VPAD_STICK_L_EMULATION_UP          = 0x10000000,
+    VPAD_STICK_L_EMULATION_RIGHT       = 0x20000000,
+    VPAD_STICK_L_EMULATION_LEFT        = 0x40000000,
+} VPADButtons;
+
+
+typedef enum VPADChan {
+    VPAD_CHAN_0 = 0,
+    VPAD_CHAN_1 = 1,
+} VPADChan;
+
+
+typedef enum VPADReadError {
+    VPAD_READ_SUCCESS               = 0,
+    VPAD_READ_NO_SAMPLES            = -1,
+    VPAD_READ_INVALID_CONTROLLER    = -2,
+    VPAD_READ_BUSY                  = -4,
+    VPAD_READ_UNINITIALIZED         = -5,
+} VPADReadError;
+
+
+typedef struct VPADVec2D {
+    float x;
+    float y;
+} VPADVec2D;
+
+
+typedef struct VPADStatus {
+    uint32_t hold;
+    uint32_t trigger;
+    uint32_t release;
+    VPADVec2D leftStick;
+    VPADVec2D rightStick;
+    uint8_t unused[0xAC - 0x1C];
+} VPADStatus;
+
+
+int32_t VPADRead(VPADChan chan, VPADStatus* buffers, uint32_t count, VPADReadError* outError);
+
+uint8_t VPADGetButtonProcMode(VPADChan chan);
+
+void VPADSetButtonProcMode(VPADChan chan, uint8_t mode);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
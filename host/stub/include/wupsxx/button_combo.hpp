@@ -0,0 +1,174 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for libwupsxx's <wupsxx/button_combo.hpp>.
+ *
+ * Only the subset used by Turbiine is provided; the implementation is in
+ * "host/stub/wupsxx.cpp".
+ */
+
+#ifndef HOST_STUB_WUPSXX_BUTTON_COMBO_HPP
+#define HOST_STUB_WUPSXX_BUTTON_COMBO_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <variant>
+
+#include <padscore/wpad.h>
+#include <vpad/input.h>
+
+
+namespace wups::utils {
+
+    namespace vpad {
+
+        struct button_set {
+
+            std::uint32_t buttons = 0;
+
+            constexpr button_set() noexcept = default;
+
+            constexpr
+            button_set(std::initializer_list<VPADButtons> list)
+                noexcept
+            {
+                for (auto b : list)
+                    buttons |= b;
+            }
+
+        };
+
+        std::string to_string(const button_set& bs);
+        std::string to_glyph(const button_set& bs);
+
+    } // namespace vpad
+
+
+    namespace wpad {
+
+        namespace core {
+
+            struct button_set {
+
+                std::uint16_t buttons = 0;
+
+                constexpr button_set() noexcept = default;
+
+                constexpr
+                button_set(std::initializer_list<WPADButton> list)
+                    noexcept
+                {
+                    for (auto b : list)
+                        buttons |= b;
+                }
+
+            };
+
+        } // namespace core
+
+
+        namespace nunchuk {
+
+            struct button_set {
+
+                std::uint16_t buttons = 0;
+
+                constexpr button_set() noexcept = default;
+
+                constexpr
+                button_set(std::initializer_list<WPADNunchukButton> list)
+                    noexcept
+                {
+                    for (auto b : list)
+                        buttons |= b;
+                }
+
+            };
+
+        } // namespace nunchuk
+
+
+        namespace classic {
+
+            struct button_set {
+
+                std::uint32_t buttons = 0;
+
+                constexpr button_set() noexcept = default;
+
+                constexpr
+                button_set(std::initializer_list<WPADClassicButton> list)
+                    noexcept
+                {
+                    for (auto b : list)
+                        buttons |= b;
+                }
+
+            };
+
+        } // namespace classic
+
+
+        namespace pro {
+
+            struct button_set {
+
+                std::uint32_t buttons = 0;
+
+                constexpr button_set() noexcept = default;
+
+                constexpr
+                button_set(std::initializer_list<WPADProButton> list)
+                    noexcept
+                {
+                    for (auto b : list)
+                        buttons |= b;
+                }
+
+            };
+
+        } // namespace pro
+
+
+        using ext_button_set = std::variant<std::monostate,
+                                            nunchuk::button_set,
+                                            classic::button_set,
+                                            pro::button_set>;
+
+
+        struct button_set {
+
+            core::button_set core;
+            ext_button_set   ext;
+
+            button_set() noexcept = default;
+
+            button_set(const core::button_set& c) noexcept :
+                core{c}
+            {}
+
+            button_set(const ext_button_set& e) noexcept :
+                ext{e}
+            {}
+
+        };
+
+        std::string to_string(const button_set& bs);
+        std::string to_glyph(const button_set& bs);
+
+    } // namespace wpad
+
+
+    using button_combo = std::variant<vpad::button_set,
+                                      wpad::button_set>;
+
+} // namespace wups::utils
+
+#endif
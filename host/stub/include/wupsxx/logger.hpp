@@ -0,0 +1,41 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for libwupsxx's <wupsxx/logger.hpp>.
+ */
+
+#ifndef HOST_STUB_WUPSXX_LOGGER_HPP
+#define HOST_STUB_WUPSXX_LOGGER_HPP
+
+#include <string_view>
+
+
+namespace wups::logger {
+
+    void initialize(std::string_view prefix);
+
+    void finalize();
+
+    __attribute__(( __format__ (__printf__, 1, 2)))
+    void printf(const char* fmt, ...);
+
+
+    struct guard {
+
+        guard(std::string_view prefix)
+        { initialize(prefix); }
+
+        ~guard()
+        { finalize(); }
+
+    };
+
+} // namespace wups::logger
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stubs for the WUT, libfunctionpatcher and libnotifications functions.
+ */
+
+#include <chrono>
+
+#include <coreinit/time.h>
+#include <coreinit/title.h>
+#include <function_patcher/function_patching.h>
+#include <notifications/notifications.h>
+#include <vpad/input.h>
+
+#include "host_stub.hpp"
+
+
+namespace host_stub {
+
+    std::array<std::uint8_t, 2> vpad_proc_mode = {0, 0};
+
+    std::uint64_t notifications = 0;
+
+    std::int64_t fake_time = -1;
+
+    std::int64_t tick_step = 0;
+
+    unsigned patches = 0;
+
+} // namespace host_stub
+
+
+extern "C"
+OSTime
+OSGetTime()
+{
+    if (host_stub::fake_time >= 0) {
+        const OSTime now = host_stub::fake_time;
+        host_stub::fake_time += host_stub::tick_step;
+        return now;
+    }
+    using clock = std::chrono::steady_clock;
+    static const auto start = clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - start);
+    return elapsed.count() * (OSTimerClockSpeed / 1000) / 1'000'000;
+}
+
+
+extern "C"
+OSTime
+OSGetSystemTime()
+{
+    return OSGetTime();
+}
+
+
+extern "C"
+OSTick
+OSGetTick()
+{
+    return static_cast<OSTick>(OSGetTime());
+}
+
+
+extern "C"
+OSTick
+OSGetSystemTick()
+{
+    return OSGetTick();
+}
+
+
+extern "C"
+uint64_t
+OSGetTitleID()
+{
+    // Pretend a game is running.
+    return 0x00050000'10101d00;
+}
+
+
+extern "C"
+uint8_t
+VPADGetButtonProcMode(VPADChan chan)
+{
+    return host_stub::vpad_proc_mode.at(chan);
+}
+
+
+extern "C"
+void
+VPADSetButtonProcMode(VPADChan chan,
+                      uint8_t mode)
+{
+    host_stub::vpad_proc_mode.at(chan) = mode;
+}
+
+
+extern "C"
+NotificationModuleStatus
+NotificationModule_AddInfoNotificationEx(const char*,
+                                         float,
+                                         NMColor,
+                                         NMColor,
+                                         NotificationModuleNotificationFinishedCallback,
+                                         void*,
+                                         bool)
+{
+    ++host_stub::notifications;
+    return NOTIFICATION_MODULE_RESULT_SUCCESS;
+}
+
+
+extern "C"
+FunctionPatcherStatus
+FunctionPatcher_InitLibrary()
+{
+    return FUNCTION_PATCHER_RESULT_SUCCESS;
+}
+
+
+extern "C"
+FunctionPatcherStatus
+FunctionPatcher_DeInitLibrary()
+{
+    return FUNCTION_PATCHER_RESULT_SUCCESS;
+}
+
+
+extern "C"
+const char*
+FunctionPatcher_GetStatusStr(FunctionPatcherStatus status)
+{
+    return status == FUNCTION_PATCHER_RESULT_SUCCESS ? "success" : "error";
+}
+
+
+extern "C"
+FunctionPatcherStatus
+FunctionPatcher_AddFunctionPatch(function_replacement_data_t*,
+                                 PatchedFunctionHandle* outHandle,
+                                 bool* outHasBeenPatched)
+{
+    *outHandle = ++host_stub::patches;
+    if (outHasBeenPatched)
+        *outHasBeenPatched = true;
+    return FUNCTION_PATCHER_RESULT_SUCCESS;
+}
+
+
+extern "C"
+FunctionPatcherStatus
+FunctionPatcher_RemoveFunctionPatch(PatchedFunctionHandle)
+{
+    --host_stub::patches;
+    return FUNCTION_PATCHER_RESULT_SUCCESS;
+}
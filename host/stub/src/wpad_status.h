@@ -0,0 +1,95 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stub for libwupsxx's "src/wpad_status.h".
+ *
+ * It's reached through "<wupsxx/../../src/wpad_status.h>", so it must live in
+ * "include/../src/".
+ */
+
+#ifndef HOST_STUB_WPAD_STATUS_H
+#define HOST_STUB_WPAD_STATUS_H
+
+#include <stdint.h>
+
+#include <padscore/wpad.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct WPADVec2D {
+    int16_t x;
+    int16_t y;
+} WPADVec2D;
+
+
+typedef struct WPADVec3D {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} WPADVec3D;
+
+
+typedef struct WPADIRObject {
+    WPADVec2D position;
+    int16_t   size;
+    uint8_t   id;
+    uint8_t   unused;
+} WPADIRObject;
+
+
+struct WPADStatus {
+    uint16_t     buttons;
+    WPADVec3D    acc;
+    WPADIRObject ir[4];
+    uint8_t      extensionType;
+    int8_t       error;
+};
+
+
+typedef struct WPADNunchukStatus {
+    WPADStatus core;
+    struct {
+        WPADVec3D acc;
+        WPADVec2D stick;
+    } ext;
+} WPADNunchukStatus;
+
+
+typedef struct WPADClassicStatus {
+    WPADStatus core;
+    struct {
+        uint16_t  buttons;
+        WPADVec2D leftStick;
+        WPADVec2D rightStick;
+        uint8_t   leftTrigger;
+        uint8_t   rightTrigger;
+    } ext;
+} WPADClassicStatus;
+
+
+typedef struct WPADProStatus {
+    WPADStatus core;
+    struct {
+        uint32_t  buttons;
+        WPADVec2D leftStick;
+        WPADVec2D rightStick;
+        int32_t   charging;
+        int32_t   wired;
+    } ext;
+} WPADProStatus;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,158 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Host stubs for the parts of libwupsxx used by Turbiine.
+ */
+
+#include <cstdarg>
+#include <cstdio>
+
+#include <wupsxx/button_combo.hpp>
+#include <wupsxx/logger.hpp>
+
+#include "host_stub.hpp"
+
+
+using std::uint32_t;
+
+
+namespace host_stub {
+
+    std::uint64_t log_lines = 0;
+
+} // namespace host_stub
+
+
+namespace wups::logger {
+
+    void
+    initialize(std::string_view)
+    {}
+
+
+    void
+    finalize()
+    {}
+
+
+    void
+    printf(const char* fmt, ...)
+    {
+        // Format the message like the real logger would, but throw it away.
+        char buf[256];
+        std::va_list args;
+        va_start(args, fmt);
+        std::vsnprintf(buf, sizeof buf, fmt, args);
+        va_end(args);
+        ++host_stub::log_lines;
+    }
+
+} // namespace wups::logger
+
+
+namespace wups::utils {
+
+    namespace {
+
+        std::string
+        join_names(uint32_t buttons,
+                   const char* const* names)
+        {
+            std::string result;
+            for (unsigned i = 0; i < 32; ++i)
+                if (buttons & (uint32_t{1} << i)) {
+                    if (!result.empty())
+                        result += " + ";
+                    result += names[i] ? names[i] : "?";
+                }
+            return result;
+        }
+
+    } // namespace
+
+
+    namespace vpad {
+
+        namespace {
+
+            const char* const names[32] = {
+                "SYNC", "HOME", "-", "+", "R", "L", "ZR", "ZL",
+                "DOWN", "UP", "RIGHT", "LEFT", "Y", "X", "B", "A",
+                "TV", "RS", "LS", nullptr, nullptr, nullptr, nullptr, "RS DOWN",
+                "RS UP", "RS RIGHT", "RS LEFT", "LS DOWN", "LS UP", "LS RIGHT", "LS LEFT",
+                nullptr,
+            };
+
+        } // namespace
+
+
+        std::string
+        to_string(const button_set& bs)
+        {
+            return join_names(bs.buttons, names);
+        }
+
+
+        std::string
+        to_glyph(const button_set& bs)
+        {
+            return join_names(bs.buttons, names);
+        }
+
+    } // namespace vpad
+
+
+    namespace wpad {
+
+        namespace {
+
+            const char* const core_names[32] = {
+                "LEFT", "RIGHT", "DOWN", "UP", "+", nullptr, nullptr, nullptr,
+                "2", "1", "B", "A", "-", "Z", "C", "HOME",
+            };
+
+            const char* const ext_names[32] = {
+                "UP", "LEFT", "ZR", "X", "A", "Y", "B", "ZL",
+                nullptr, "R", "+", "HOME", "-", "L", "DOWN", "RIGHT",
+                "RS", "LS",
+            };
+
+        } // namespace
+
+
+        std::string
+        to_string(const button_set& bs)
+        {
+            std::string result = join_names(bs.core.buttons, core_names);
+            uint32_t ext = visit([]<typename T>(const T& x) -> uint32_t
+                                 {
+                                     if constexpr (requires { x.buttons; })
+                                         return x.buttons;
+                                     else
+                                         return 0;
+                                 },
+                                 bs.ext);
+            if (ext) {
+                if (!result.empty())
+                    result += " + ";
+                result += join_names(ext, ext_names);
+            }
+            return result;
+        }
+
+
+        std::string
+        to_glyph(const button_set& bs)
+        {
+            return to_string(bs);
+        }
+
+    } // namespace wpad
+
+} // namespace wups::utils
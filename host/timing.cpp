@@ -0,0 +1,401 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+/*
+ * Turbo timing analyzer.
+ *
+ * Measures the turbo presses the game actually sees, while a turbo button is held down:
+ *
+ *   freq     game-visible presses per second
+ *   duty     fraction of the samples where the game sees the button pressed
+ *   jitter   standard deviation of the time between game-visible presses
+ *   latency  time from the physical press to the first game-visible press
+ *
+ * By default it feeds long holds of a turbo button through the real hook bodies, for every
+ * controller type, Period, Rate and poll rate. With -c, it analyzes the output stream in a
+ * capture file from the console instead, for every button that had turbo presses.
+ *
+ *   turbiine-timing [-i]
+ *   turbiine-timing -c capture.bin
+ */
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <coreinit/time.h>
+
+#include "capture.hpp"
+#include "cfg.hpp"
+#include "notify.hpp"
+#include "snapshot.hpp"
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+#include "capture_reader.hpp"
+#include "driver.hpp"
+#include "stub/host_stub.hpp"
+
+
+using std::uint32_t;
+using std::uint64_t;
+
+using namespace driver;
+
+
+namespace {
+
+    double
+    to_ms(uint64_t ticks)
+    {
+        return ticks * 1000.0 / OSTimerClockSpeed;
+    }
+
+
+    // Timing of one button, over all the holds where it had turbo presses.
+    class analyzer {
+
+        // Current hold.
+        bool     held       = false;
+        bool     visible    = false; // game sees it pressed in the last sample
+        bool     toggled    = false; // the game saw it released at some point
+        uint64_t hold_start = 0;
+        uint64_t last_press = 0;
+        uint64_t first_press = 0;
+        unsigned hold_samples = 0;
+        unsigned hold_visible = 0;
+        unsigned hold_presses = 0;
+        std::vector<double> hold_intervals;
+
+    public:
+
+        unsigned holds    = 0;
+        unsigned presses  = 0;
+        unsigned samples  = 0; // held
+        unsigned pressed  = 0; // held and visible
+        uint64_t held_ticks = 0;
+        double   latency_sum = 0;
+        double   latency_max = 0;
+        std::vector<double> intervals; // ms between visible presses
+
+
+        void
+        feed(uint64_t time,
+             bool raw,
+             bool out)
+        {
+            if (raw && !held) {
+                held = true;
+                toggled = false;
+                hold_start = time;
+                first_press = 0;
+                hold_samples = hold_visible = hold_presses = 0;
+                hold_intervals.clear();
+                visible = false;
+            }
+
+            if (!raw) {
+                if (held)
+                    end_hold(time);
+                held = false;
+                visible = out;
+                return;
+            }
+
+            ++hold_samples;
+            if (out) {
+                ++hold_visible;
+                if (!visible) {
+                    if (hold_presses)
+                        hold_intervals.push_back(to_ms(time - last_press));
+                    else
+                        first_press = time;
+                    ++hold_presses;
+                    last_press = time;
+                }
+            } else
+                toggled = true;
+            visible = out;
+        }
+
+
+        void
+        end_hold(uint64_t time)
+        {
+            // Only holds where the game saw turbo presses count.
+            if (!toggled || hold_presses < 2)
+                return;
+            ++holds;
+            presses += hold_presses;
+            samples += hold_samples;
+            pressed += hold_visible;
+            held_ticks += time - hold_start;
+            const double latency = to_ms(first_press - hold_start);
+            latency_sum += latency;
+            if (latency > latency_max)
+                latency_max = latency;
+            intervals.insert(intervals.end(), hold_intervals.begin(), hold_intervals.end());
+        }
+
+
+        double
+        freq()
+            const
+        {
+            return held_ticks ? presses * double(OSTimerClockSpeed) / held_ticks : 0;
+        }
+
+
+        double
+        duty()
+            const
+        {
+            return samples ? double(pressed) / samples : 0;
+        }
+
+
+        double
+        jitter()
+            const
+        {
+            if (intervals.size() < 2)
+                return 0;
+            double mean = 0;
+            for (double x : intervals)
+                mean += x;
+            mean /= intervals.size();
+            double var = 0;
+            for (double x : intervals)
+                var += (x - mean) * (x - mean);
+            return std::sqrt(var / intervals.size());
+        }
+
+
+        double
+        latency()
+            const
+        {
+            return holds ? latency_sum / holds : 0;
+        }
+
+    };
+
+
+    void
+    print_header(const char* first)
+    {
+        std::printf("%-16s %6s %8s %6s %10s %11s %11s\n",
+                    first, "holds", "freq(Hz)", "duty", "jitter(ms)", "latency(ms)", "max(ms)");
+    }
+
+
+    void
+    print_row(const char* label,
+              const analyzer& a)
+    {
+        std::printf("%-16s %6u %8.2f %6.2f %10.2f %11.2f %11.2f\n",
+                    label, a.holds, a.freq(), a.duty(), a.jitter(), a.latency(),
+                    a.latency_max);
+    }
+
+
+    // Small deterministic generator, so the results are the same everywhere.
+    uint32_t seed = 1;
+
+    unsigned
+    random(unsigned lo,
+           unsigned hi)
+    {
+        seed = seed * 1664525 + 1013904223;
+        return lo + (seed >> 16) % (hi - lo + 1);
+    }
+
+
+    struct timing {
+        int period;
+        int rate;
+    };
+
+
+    const timing timings[] = {
+        {1, 0},
+        {2, 0},
+        {3, 0},
+        {4, 0},
+        {6, 0},
+        {1, 5},
+        {1, 10},
+        {1, 15},
+    };
+
+
+    const unsigned poll_rates[] = {60, 100, 200};
+
+
+    // Hold the first button of a family down many times, with turbo on.
+    analyzer
+    measure(family f,
+            unsigned poll_rate,
+            const timing& tm)
+    {
+        const auto info = make_family_info(f);
+        const input& button = info.buttons.front();
+        const uint64_t interval = OSTimerClockSpeed / poll_rate;
+
+        cfg::period = tm.period;
+        cfg::rate   = tm.rate;
+        snapshot::publish();
+
+        vpad::reset();
+        wpad::reset();
+        select_family(f);
+        seed = 1;
+
+        auto step = [&](const input& in)
+        {
+            host_stub::fake_time += interval;
+            return feed(f, in);
+        };
+
+        step({});
+        step({});
+        step(info.combo);
+        step({});
+        step(button);
+        step({});
+
+        analyzer a;
+        for (unsigned i = 0; i < 50; ++i) {
+            for (unsigned gap = random(poll_rate / 10, poll_rate / 2); gap; --gap) {
+                const auto out = step({});
+                a.feed(host_stub::fake_time, false, (out.hold.core & button.core)
+                                                    || (out.hold.ext & button.ext));
+            }
+            for (unsigned held = random(poll_rate, 3 * poll_rate); held; --held) {
+                const auto out = step(button);
+                a.feed(host_stub::fake_time, true, (out.hold.core & button.core)
+                                                   || (out.hold.ext & button.ext));
+            }
+        }
+        a.end_hold(host_stub::fake_time);
+        return a;
+    }
+
+
+    int
+    sweep()
+    {
+        host_stub::fake_time = 0;
+        std::printf("# immediate = %s\n", cfg::immediate ? "yes" : "no");
+        print_header("pad poll period rate");
+
+        for (auto f : {family::vpad, family::core, family::nunchuk,
+                       family::classic, family::pro})
+            for (auto poll : poll_rates)
+                for (const auto& tm : timings) {
+                    const auto a = measure(f, poll, tm);
+                    char label[32];
+                    std::snprintf(label, sizeof label, "%-7s %3u %2d %2d",
+                                  to_string(f), poll, tm.period, tm.rate);
+                    print_row(label, a);
+                }
+        return 0;
+    }
+
+
+    // Analyze every button of every channel in a capture file.
+    int
+    analyze(const char* filename)
+    {
+        capture_reader::contents c;
+        if (!capture_reader::load(filename, c))
+            return 1;
+        const unsigned num_streams = c.num_streams;
+
+        // For each stream, the core bits then the extension bits.
+        std::vector<std::array<analyzer, 64>> buttons(num_streams);
+        std::vector<capture::sample> last(num_streams);
+        std::vector<uint64_t> time(num_streams);
+        std::vector<uint64_t> start(num_streams);
+        std::vector<uint64_t> polls(num_streams);
+
+        for (const auto& r : c.records) {
+            const unsigned stream = r.stream;
+            if (!time[stream])
+                start[stream] = r.dt;
+            else if (r.sample.first)
+                ++polls[stream];
+            time[stream] = r.time;
+            const capture::sample& s = last[stream] = r.sample;
+            for (unsigned bit = 0; bit < 32; ++bit) {
+                const uint32_t mask = uint32_t{1} << bit;
+                buttons[stream][bit].feed(time[stream], s.raw_core & mask, s.out_core & mask);
+                buttons[stream][32 + bit].feed(time[stream],
+                                               s.raw_ext & mask, s.out_ext & mask);
+            }
+        }
+
+        print_header("channel button");
+        for (unsigned stream = 0; stream < num_streams; ++stream) {
+            const bool is_vpad = stream < vpad::max_vpads;
+            const unsigned channel = is_vpad ? stream : stream - vpad::max_vpads;
+            for (unsigned i = 0; i < 64; ++i) {
+                auto& a = buttons[stream][i];
+                a.end_hold(time[stream]);
+                if (!a.holds)
+                    continue;
+                const uint32_t mask = uint32_t{1} << (i % 32);
+                notify::pad source = notify::pad::vpad;
+                if (!is_vpad)
+                    source = i < 32 ? notify::pad::wpad_core : last[stream].family;
+                char label[64];
+                std::snprintf(label, sizeof label, "%s %u %s",
+                              is_vpad ? "vpad" : "wpad", channel,
+                              notify::to_string(source, mask).c_str());
+                print_row(label, a);
+            }
+            if (polls[stream])
+                std::printf("# %s %u: %.1f reads/s\n",
+                            is_vpad ? "vpad" : "wpad", channel,
+                            polls[stream] * double(OSTimerClockSpeed)
+                            / (time[stream] - start[stream]));
+        }
+        return 0;
+    }
+
+} // namespace
+
+
+int
+main(int argc,
+     char* argv[])
+{
+    const char* capture_file = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-i")
+            cfg::immediate = true;
+        else if (arg == "-c" && i + 1 < argc)
+            capture_file = argv[++i];
+        else {
+            std::fprintf(stderr, "Usage: %s [-i]\n       %s -c capture.bin\n",
+                         argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (capture_file)
+        return analyze(capture_file);
+
+    install();
+    return sweep();
+}
@@ -61,6 +61,32 @@ AC_DEFUN([WIIU_WUMS_CHECK_LIBCURLWRAPPER],[
 ])
 
 
+# WIIU_WUMS_CHECK_LIBFUNCTIONPATCHER([ACTION-IF-FOUND], [ACTION-IF-NOT-FOUND])
+# ----------------------------------------------------------------------------
+#
+# Checks for presence of libfunctionpatcher.
+#
+# Output variables:
+#   - `DEVKITPRO_LIBS'
+#   - `HAVE_WIIU_WUMS_LIBFUNCTIONPATCHER'
+
+AC_DEFUN([WIIU_WUMS_CHECK_LIBFUNCTIONPATCHER],[
+
+    AC_REQUIRE([WIIU_WUMS_INIT])
+
+    DEVKITPRO_CHECK_LIBRARY([WIIU_WUMS_LIBFUNCTIONPATCHER],
+                            [function_patcher/function_patching.h],
+                            [functionpatcher],
+                            [],
+                            [$1],
+                            m4_default([$2],
+                                       [AC_MSG_ERROR([libfunctionpatcher not found in $WIIU_WUMS_ROOT; get it from https://github.com/wiiu-env/libfunctionpatcher])]
+                                      )
+                           )
+
+])
+
+
 # WIIU_WUMS_CHECK_LIBMAPPEDMEMORY([ACTION-IF-FOUND], [ACTION-IF-NOT-FOUND])
 # -------------------------------------------------------------------------
 #
@@ -0,0 +1,331 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include <coreinit/time.h>
+#include <coreinit/title.h>
+
+#include <wupsxx/logger.hpp>
+
+#include "capture.hpp"
+
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+
+using std::uint8_t;
+using std::uint32_t;
+
+namespace logger = wups::logger;
+
+
+namespace capture {
+
+    namespace {
+
+#ifdef __WIIU__
+        const char* path_prefix = "fs:/vol/external01/wiiu/";
+#else
+        const char* path_prefix = "";
+#endif
+
+        // Stop writing after this many bytes, so a forgotten capture doesn't fill the SD
+        // card; at 60 samples/s, this is several hours.
+        constexpr long max_file_size = 32 * 1024 * 1024;
+
+        constexpr unsigned num_streams = vpad::max_vpads + wpad::max_wpads;
+
+        // Samples in each half; the worker takes them every 50 ms, so even the loose mode,
+        // with many samples per read, doesn't fill it up.
+        constexpr unsigned half_size = 128;
+
+
+        /*
+         * Double buffer for one channel: the hook fills one half, while the other waits for
+         * the worker. Only the hook of this channel writes to it, so each half has a single
+         * producer and a single consumer.
+         */
+        struct stream {
+
+            struct half {
+                std::array<sample, half_size> samples;
+                std::uint16_t     size = 0;    // set when it becomes ready
+                uint32_t          gap  = 0;    // samples dropped before this half
+                std::atomic<bool> ready = false; // full, waiting for the worker
+            };
+
+            std::array<half, 2> halves;
+
+            // The worker wants the samples collected so far.
+            std::atomic<bool> swap_requested = false;
+
+            // Only the hook touches these.
+            std::uint16_t count   = 0; // samples in the active half
+            uint8_t       active  = 0;
+            uint32_t      dropped = 0;
+
+
+            // Hand the active half to the worker, if it's done with the other one.
+            void
+            flip()
+                noexcept
+            {
+                half& other = halves[active ^ 1];
+                if (other.ready.load(std::memory_order_acquire))
+                    return;
+                swap_requested.store(false, std::memory_order_relaxed);
+                if (!count)
+                    return;
+                half& cur = halves[active];
+                cur.size = count;
+                cur.ready.store(true, std::memory_order_release);
+                other.gap = dropped;
+                dropped = 0;
+                count   = 0;
+                active ^= 1;
+            }
+
+
+            void
+            push(const sample& s)
+                noexcept
+            {
+                if (count == half_size
+                    || swap_requested.load(std::memory_order_relaxed)) [[unlikely]]
+                    flip();
+                if (count == half_size) [[unlikely]] {
+                    ++dropped;
+                    return;
+                }
+                halves[active].samples[count++] = s;
+            }
+
+        };
+
+
+        // VPAD channels first, then WPAD channels.
+        std::array<stream, num_streams> streams;
+
+
+        // Everything below is only used by the worker thread.
+
+        struct file_closer {
+            void operator ()(std::FILE* f) const noexcept { std::fclose(f); }
+        };
+
+        std::unique_ptr<std::FILE, file_closer> file;
+
+        bool file_failed = false; // don't retry opening it on every flush
+
+        long file_size = 0;
+
+        std::array<sample, num_streams> last{}; // previous sample of each stream
+
+        std::vector<uint8_t> out;
+
+
+        void
+        put_varint(std::vector<uint8_t>& dst,
+                   uint32_t value)
+        {
+            while (value >= 0x80) {
+                dst.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            dst.push_back(static_cast<uint8_t>(value));
+        }
+
+
+        template<unsigned N>
+        void
+        put_le(std::vector<uint8_t>& dst,
+               std::uint64_t value)
+        {
+            for (unsigned i = 0; i < N; ++i)
+                dst.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+
+
+        void
+        encode(uint8_t idx,
+               const sample& s,
+               uint32_t gap)
+        {
+            sample& prev = last[idx];
+
+            uint8_t fields = 0;
+            if (gap)
+                fields |= format::gap;
+            if (s.raw_core != prev.raw_core)
+                fields |= format::raw_core;
+            if (s.raw_ext != prev.raw_ext)
+                fields |= format::raw_ext;
+            if (s.out_core != prev.out_core)
+                fields |= format::out_core;
+            if (s.out_ext != prev.out_ext)
+                fields |= format::out_ext;
+            if (s.family != prev.family)
+                fields |= format::family;
+            if (s.first)
+                fields |= format::first;
+            if (s.loose)
+                fields |= format::loose;
+
+            out.push_back(idx);
+            out.push_back(fields);
+            put_varint(out, s.time - prev.time);
+            if (fields & format::gap)
+                put_varint(out, gap);
+            if (fields & format::raw_core)
+                put_varint(out, s.raw_core ^ prev.raw_core);
+            if (fields & format::raw_ext)
+                put_varint(out, s.raw_ext ^ prev.raw_ext);
+            if (fields & format::out_core)
+                put_varint(out, s.out_core ^ prev.out_core);
+            if (fields & format::out_ext)
+                put_varint(out, s.out_ext ^ prev.out_ext);
+            if (fields & format::family)
+                put_varint(out, static_cast<uint8_t>(s.family)
+                                ^ static_cast<uint8_t>(prev.family));
+
+            prev = s;
+        }
+
+
+        void
+        encode(uint8_t idx,
+               const stream::half& h,
+               unsigned size)
+        {
+            for (unsigned i = 0; i < size; ++i)
+                encode(idx, h.samples[i], i ? 0 : h.gap);
+        }
+
+
+        bool
+        open_file()
+        {
+            if (file)
+                return true;
+            if (file_failed)
+                return false;
+
+            char name[128];
+            std::snprintf(name, sizeof name, "%sturbiine-capture-%016llx.bin",
+                          path_prefix,
+                          static_cast<unsigned long long>(OSGetTitleID()));
+            file.reset(std::fopen(name, "wb"));
+            if (!file) {
+                logger::printf("Could not create capture file \"%s\".\n", name);
+                file_failed = true;
+                return false;
+            }
+            logger::printf("Capturing input to \"%s\".\n", name);
+
+            std::vector<uint8_t> header;
+            header.insert(header.end(), format::magic, format::magic + sizeof format::magic);
+            header.push_back(format::version);
+            header.push_back(num_streams);
+            put_le<2>(header, 0);
+            put_le<4>(header, OSTimerClockSpeed);
+            put_le<8>(header, OSGetTitleID());
+            std::fwrite(header.data(), 1, header.size(), file.get());
+            file_size = header.size();
+            return true;
+        }
+
+
+        void
+        write_out()
+        {
+            if (out.empty() || !file)
+                return;
+            if (file_size + static_cast<long>(out.size()) > max_file_size) {
+                logger::printf("Capture file is full, stopped capturing.\n");
+                file.reset();
+                file_failed = true;
+                out.clear();
+                return;
+            }
+            if (std::fwrite(out.data(), 1, out.size(), file.get()) != out.size()) {
+                logger::printf("Error writing the capture file.\n");
+                file.reset();
+                file_failed = true;
+            }
+            file_size += out.size();
+            out.clear();
+        }
+
+
+        // Encode the halves that are ready; with "all", the active halves too.
+        void
+        collect(bool all)
+        {
+            for (uint8_t idx = 0; idx < num_streams; ++idx) {
+                stream& st = streams[idx];
+                for (auto& h : st.halves)
+                    if (h.ready.load(std::memory_order_acquire)) {
+                        if (!file_failed)
+                            encode(idx, h, h.size);
+                        h.ready.store(false, std::memory_order_release);
+                    }
+                if (all) {
+                    if (!file_failed)
+                        encode(idx, st.halves[st.active], st.count);
+                    st.count   = 0;
+                    st.dropped = 0;
+                } else
+                    st.swap_requested.store(true, std::memory_order_relaxed);
+            }
+        }
+
+    } // namespace
+
+
+    void
+    push(notify::pad source,
+         unsigned channel,
+         const sample& s)
+        noexcept
+    {
+        if (source != notify::pad::vpad)
+            channel += vpad::max_vpads;
+        streams[channel].push(s);
+    }
+
+
+    void
+    flush()
+    {
+        collect(false);
+        if (!out.empty() && open_file())
+            write_out();
+        out.clear();
+    }
+
+
+    void
+    finish()
+    {
+        collect(true);
+        if (!out.empty() && open_file())
+            write_out();
+        out.clear();
+        file.reset();
+        file_failed = false;
+        // The next application starts a new file.
+        last = {};
+    }
+
+} // namespace capture
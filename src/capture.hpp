@@ -0,0 +1,103 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include <cstdint>
+
+#include "notify.hpp"
+
+
+/*
+ * Input capture: the buttons of every sample, before and after Turbiine, written to a
+ * binary file on the SD card.
+ *
+ * The hooks only copy each sample into a double buffer owned by the channel; the worker
+ * thread takes the full halves, encodes them, and writes them to the file.
+ */
+
+namespace capture {
+
+    // One sample from one channel.
+    struct sample {
+        std::uint32_t time;     // OSGetSystemTick() when the hook read it
+        std::uint32_t raw_core; // buttons the controller reported
+        std::uint32_t raw_ext;  // only used by the classic and pro extensions
+        std::uint32_t out_core; // buttons the game got
+        std::uint32_t out_ext;
+        notify::pad   family;
+        bool          first;    // first sample of a read by the game
+        bool          loose;    // VPAD in loose mode, see VPADSetButtonProcMode()
+    };
+
+
+    /*
+     * File format, all integers little-endian:
+     *
+     *   header:
+     *     char[4]  magic
+     *     uint8    version
+     *     uint8    number of streams (VPAD channels first, then WPAD channels)
+     *     uint16   reserved
+     *     uint32   ticks per second
+     *     uint64   title ID
+     *
+     *   records, until the end of the file:
+     *     uint8    stream
+     *     uint8    fields present, see format::field
+     *     varint   ticks since the previous sample of this stream
+     *     varint   samples dropped before this one, only if field::gap is present
+     *     varint   each field present, in bit order, XORed with its previous value
+     *
+     * Varints are LEB128: 7 bits per byte, lowest first. Every stream starts with all
+     * fields, including the time, at zero. The field::first and field::loose bits are
+     * flags of this sample only, with no varint.
+     *
+     * A VPAD read returns up to 16 samples, and the hardware doesn't tell when each one was
+     * taken; so all samples of a read have the time of the read, and only field::first
+     * tells where each read starts.
+     */
+    namespace format {
+
+        inline constexpr char magic[4] = {'T', 'B', 'C', 'P'};
+
+        inline constexpr std::uint8_t version = 2;
+
+        inline constexpr unsigned header_size = 20;
+
+        enum field : std::uint8_t {
+            raw_core = 1 << 0,
+            raw_ext  = 1 << 1,
+            out_core = 1 << 2,
+            out_ext  = 1 << 3,
+            family   = 1 << 4,
+            first    = 1 << 5,
+            loose    = 1 << 6,
+            gap      = 1 << 7,
+        };
+
+    } // namespace format
+
+
+    // Only a few stores, doesn't block, doesn't allocate; the source can be any WPAD
+    // family, they all share the same stream.
+    void push(notify::pad source,
+              unsigned channel,
+              const sample& s) noexcept;
+
+
+    // Write the captured samples to the file; called by the worker thread.
+    void flush();
+
+    // Write everything left and close the file; only when the hooks are not running.
+    void finish();
+
+} // namespace capture
+
+#endif
@@ -6,6 +6,10 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <chrono>
+#include <string>
+#include <utility>
+
 #include <wupsxx/bool_item.hpp>
 #include <wupsxx/button_combo_item.hpp>
 #include <wupsxx/int_item.hpp>
@@ -13,10 +17,15 @@
 #include <wupsxx/init.hpp>
 #include <wupsxx/logger.hpp>
 #include <wupsxx/storage.hpp>
+#include <wupsxx/text_item.hpp>
 
 #include "cfg.hpp"
 
+#include "hooks.hpp"
+#include "profiles.hpp"
 #include "reset_turbo_item.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
 
 #ifdef HAVE_CONFIG_H
 #include <config.h>
@@ -25,6 +34,8 @@
 
 using std::array;
 
+using namespace std::literals;
+
 using namespace wups::config;
 using namespace wups::utils;
 
@@ -43,6 +54,16 @@ namespace cfg {
 
         const int period = 1;
 
+        const int rate = 0;
+
+        const bool immediate = false;
+
+        const int turbo_sync = 0;
+
+        const bool remember_turbo = true;
+
+        const bool remember_rate = false;
+
         const array<button_combo, max_toggle_combos> toggle_combo = {
             vpad::button_set{VPAD_BUTTON_TV,
                              VPAD_BUTTON_ZL},
@@ -57,6 +78,19 @@ namespace cfg {
                                                    WPAD_PRO_TRIGGER_ZL}}
         };
 
+        const pattern pattern{};
+
+        // Macros have no combo by default.
+        const button_combo macro_combo{};
+
+        const bool capture = false;
+
+        const button_remap remap{};
+
+        const int stick_dpad = 0;
+
+        const int time_budget = 1000;
+
     } // namespace defaults
 
 
@@ -64,38 +98,300 @@ namespace cfg {
 
     int period = defaults::period;
 
+    int rate = defaults::rate;
+
+    bool immediate = defaults::immediate;
+
+    int turbo_sync = defaults::turbo_sync;
+
+    bool remember_turbo = defaults::remember_turbo;
+
+    bool remember_rate = defaults::remember_rate;
+
     array<button_combo, max_toggle_combos> toggle_combo = defaults::toggle_combo;
 
+    array<pattern, max_patterns> patterns;
+
+    button_combo record_combo;
+
+    button_combo play_combo;
+
+    bool capture = defaults::capture;
+
+    array<button_remap, max_remaps> remaps;
+
+    int left_stick_dpad = defaults::stick_dpad;
+
+    int right_stick_dpad = defaults::stick_dpad;
+
+    int time_budget = defaults::time_budget;
+
+
+    // What is in the storage right now, to only store the items that changed.
+    namespace stored {
+
+        bool enabled;
+
+        int period;
+
+        int rate;
+
+        bool immediate;
+
+        int turbo_sync;
+
+        bool remember_turbo;
+
+        bool remember_rate;
+
+        array<button_combo, max_toggle_combos> toggle_combo;
+
+        array<pattern, max_patterns> patterns;
+
+        button_combo record_combo;
+
+        button_combo play_combo;
+
+        bool capture;
+
+        array<button_remap, max_remaps> remaps;
+
+        int left_stick_dpad;
+
+        int right_stick_dpad;
+
+        int time_budget;
+
+    } // namespace stored
+
+
+    std::mutex storage_mutex;
+
+    // Wait until the settings stop changing for this long before writing to the SD card.
+    const auto flush_delay = 2s;
+
+    bool dirty = false;
+
+    std::chrono::steady_clock::time_point dirty_time;
+
+    // With "Remember rate per game", the menu edits the rate of the running title, not
+    // cfg::rate; see profiles::apply().
+    bool menu_edits_game_rate = false;
+
+    int game_rate = 0;
+
+
+    bool
+    same(const button_combo& a,
+         const button_combo& b)
+        noexcept
+    {
+        if (a.index() != b.index())
+            return false;
+
+        if (auto x = get_if<vpad::button_set>(&a))
+            return x->buttons == get<vpad::button_set>(b).buttons;
+
+        const auto& x = get<wpad::button_set>(a);
+        const auto& y = get<wpad::button_set>(b);
+        if (x.core.buttons != y.core.buttons || x.ext.index() != y.ext.index())
+            return false;
+        if (auto e = get_if<wpad::nunchuk::button_set>(&x.ext))
+            return e->buttons == get<wpad::nunchuk::button_set>(y.ext).buttons;
+        if (auto e = get_if<wpad::classic::button_set>(&x.ext))
+            return e->buttons == get<wpad::classic::button_set>(y.ext).buttons;
+        if (auto e = get_if<wpad::pro::button_set>(&x.ext))
+            return e->buttons == get<wpad::pro::button_set>(y.ext).buttons;
+        return true;
+    }
+
+
+    template<typename T>
+    bool
+    same(const T& a,
+         const T& b)
+        noexcept
+    {
+        return a == b;
+    }
+
+
+    // Store the item only if it's different from what's in the storage.
+    template<typename T>
+    bool
+    store_changed(const std::string& key,
+                  const T& value,
+                  T& last)
+    {
+        if (same(value, last))
+            return false;
+        wups::storage::store(key, value);
+        last = value;
+        return true;
+    }
+
 
     void
     load()
     {
         using wups::storage::load_or_init;
 
+        std::lock_guard guard{storage_mutex};
+
         load_or_init("enabled", enabled, defaults::enabled);
 
         load_or_init("period", period, defaults::period);
 
+        load_or_init("rate", rate, defaults::rate);
+
+        load_or_init("immediate", immediate, defaults::immediate);
+
+        load_or_init("turbo_sync", turbo_sync, defaults::turbo_sync);
+
+        load_or_init("remember_turbo", remember_turbo, defaults::remember_turbo);
+
+        load_or_init("remember_rate", remember_rate, defaults::remember_rate);
+
         for (unsigned i = 0; i < max_toggle_combos; ++i)
             load_or_init("toggle" + std::to_string(i + 1),
                          toggle_combo[i],
                          defaults::toggle_combo[i]);
+
+        for (unsigned i = 0; i < max_patterns; ++i) {
+            const std::string prefix = "pattern" + std::to_string(i + 1) + "_";
+            auto& p = patterns[i];
+            load_or_init(prefix + "buttons", p.buttons, defaults::pattern.buttons);
+            load_or_init(prefix + "cycle",   p.cycle,   defaults::pattern.cycle);
+            load_or_init(prefix + "duty",    p.duty,    defaults::pattern.duty);
+            load_or_init(prefix + "burst",   p.burst,   defaults::pattern.burst);
+            load_or_init(prefix + "phase",   p.phase,   defaults::pattern.phase);
+        }
+
+        load_or_init("record", record_combo, defaults::macro_combo);
+
+        load_or_init("play", play_combo, defaults::macro_combo);
+
+        load_or_init("capture", capture, defaults::capture);
+
+        for (unsigned i = 0; i < max_remaps; ++i) {
+            const std::string prefix = "remap" + std::to_string(i + 1) + "_";
+            load_or_init(prefix + "from", remaps[i].from, defaults::remap.from);
+            load_or_init(prefix + "to",   remaps[i].to,   defaults::remap.to);
+        }
+
+        load_or_init("left_stick_dpad", left_stick_dpad, defaults::stick_dpad);
+
+        load_or_init("right_stick_dpad", right_stick_dpad, defaults::stick_dpad);
+
+        load_or_init("time_budget", time_budget, defaults::time_budget);
+
+        stored::enabled          = enabled;
+        stored::period           = period;
+        stored::rate             = rate;
+        stored::immediate        = immediate;
+        stored::turbo_sync       = turbo_sync;
+        stored::remember_turbo   = remember_turbo;
+        stored::remember_rate    = remember_rate;
+        stored::toggle_combo     = toggle_combo;
+        stored::patterns         = patterns;
+        stored::record_combo     = record_combo;
+        stored::play_combo       = play_combo;
+        stored::capture          = capture;
+        stored::remaps           = remaps;
+        stored::left_stick_dpad  = left_stick_dpad;
+        stored::right_stick_dpad = right_stick_dpad;
+        stored::time_budget      = time_budget;
+
+        snapshot::publish();
     }
 
 
+    // Only stores the changed items in memory; the worker thread writes them to the SD
+    // card later.
     void
     save()
     {
-        using wups::storage::store;
+        std::lock_guard guard{storage_mutex};
+
+        bool changed = false;
+
+        changed |= store_changed("enabled", enabled, stored::enabled);
+
+        changed |= store_changed("period", period, stored::period);
 
-        store("enabled", enabled);
+        changed |= store_changed("rate", rate, stored::rate);
 
-        store("period", period);
+        changed |= store_changed("immediate", immediate, stored::immediate);
+
+        changed |= store_changed("turbo_sync", turbo_sync, stored::turbo_sync);
+
+        changed |= store_changed("remember_turbo", remember_turbo, stored::remember_turbo);
+
+        changed |= store_changed("remember_rate", remember_rate, stored::remember_rate);
 
         for (unsigned i = 0; i < max_toggle_combos; ++i)
-            store("toggle" + std::to_string(i + 1),
-                  toggle_combo[i]);
+            changed |= store_changed("toggle" + std::to_string(i + 1),
+                                     toggle_combo[i],
+                                     stored::toggle_combo[i]);
+
+        for (unsigned i = 0; i < max_patterns; ++i) {
+            const std::string prefix = "pattern" + std::to_string(i + 1) + "_";
+            const auto& p = patterns[i];
+            auto& s = stored::patterns[i];
+            changed |= store_changed(prefix + "buttons", p.buttons, s.buttons);
+            changed |= store_changed(prefix + "cycle",   p.cycle,   s.cycle);
+            changed |= store_changed(prefix + "duty",    p.duty,    s.duty);
+            changed |= store_changed(prefix + "burst",   p.burst,   s.burst);
+            changed |= store_changed(prefix + "phase",   p.phase,   s.phase);
+        }
+
+        changed |= store_changed("record", record_combo, stored::record_combo);
+
+        changed |= store_changed("play", play_combo, stored::play_combo);
+
+        changed |= store_changed("capture", capture, stored::capture);
+
+        for (unsigned i = 0; i < max_remaps; ++i) {
+            const std::string prefix = "remap" + std::to_string(i + 1) + "_";
+            const auto& r = remaps[i];
+            auto& s = stored::remaps[i];
+            changed |= store_changed(prefix + "from", r.from, s.from);
+            changed |= store_changed(prefix + "to",   r.to,   s.to);
+        }
+
+        changed |= store_changed("left_stick_dpad", left_stick_dpad,
+                                 stored::left_stick_dpad);
+
+        changed |= store_changed("right_stick_dpad", right_stick_dpad,
+                                 stored::right_stick_dpad);
+
+        changed |= store_changed("time_budget", time_budget, stored::time_budget);
+
+        if (changed)
+            touch();
+    }
+
+
+    void
+    touch()
+    {
+        dirty = true;
+        dirty_time = std::chrono::steady_clock::now();
+    }
+
+
+    void
+    flush(bool force)
+    {
+        std::lock_guard guard{storage_mutex};
+
+        if (!dirty)
+            return;
+        if (!force && std::chrono::steady_clock::now() - dirty_time < flush_delay)
+            return;
 
+        // Clear it first: if saving fails, don't retry every time.
+        dirty = false;
         wups::storage::save();
     }
 
@@ -115,11 +411,122 @@ namespace cfg {
                                   defaults::period,
                                   1, 100));
 
+        menu_edits_game_rate = remember_rate;
+        game_rate = snapshot::effective_rate();
+        if (menu_edits_game_rate)
+            root.add(int_item::create("Rate for this game (0 = use Period)",
+                                      game_rate,
+                                      defaults::rate,
+                                      0, 30));
+        else
+            root.add(int_item::create("Rate (0 = use Period)",
+                                      rate,
+                                      defaults::rate,
+                                      0, 30));
+
+        root.add(bool_item::create("Immediate first press",
+                                   immediate,
+                                   defaults::immediate,
+                                   "yes", "no"));
+
+        root.add(int_item::create("Sync turbo (0 = off, 1 = controller, 2 = all)",
+                                  turbo_sync,
+                                  defaults::turbo_sync,
+                                  0, 2));
+
+        root.add(bool_item::create("Remember turbos per game",
+                                   remember_turbo,
+                                   defaults::remember_turbo,
+                                   "yes", "no"));
+
+        root.add(bool_item::create("Remember rate per game",
+                                   remember_rate,
+                                   defaults::remember_rate,
+                                   "yes", "no"));
+
         for  (unsigned i = 0; i < max_toggle_combos; ++i)
             root.add(button_combo_item::create("Toggle turbo " + std::to_string(i + 1),
                                                toggle_combo[i],
                                                defaults::toggle_combo[i]));
 
+        for (unsigned i = 0; i < max_patterns; ++i) {
+            auto& p = patterns[i];
+            auto cat = category::create("Pattern " + std::to_string(i + 1));
+
+            cat->add(button_combo_item::create("Buttons",
+                                               p.buttons,
+                                               defaults::pattern.buttons));
+
+            cat->add(int_item::create("Cycle (steps)",
+                                      p.cycle,
+                                      defaults::pattern.cycle,
+                                      1, 32));
+
+            cat->add(int_item::create("Pressed (steps)",
+                                      p.duty,
+                                      defaults::pattern.duty,
+                                      0, 32));
+
+            cat->add(int_item::create("Burst (0 = no limit)",
+                                      p.burst,
+                                      defaults::pattern.burst,
+                                      0, 16));
+
+            cat->add(int_item::create("Start step",
+                                      p.phase,
+                                      defaults::pattern.phase,
+                                      0, 31));
+
+            root.add(std::move(cat));
+        }
+
+        {
+            auto cat = category::create("Macros");
+            cat->add(button_combo_item::create("Record macro",
+                                               record_combo,
+                                               defaults::macro_combo));
+            cat->add(button_combo_item::create("Play macro",
+                                               play_combo,
+                                               defaults::macro_combo));
+            root.add(std::move(cat));
+        }
+
+        {
+            auto cat = category::create("Remap buttons");
+            for (unsigned i = 0; i < max_remaps; ++i) {
+                const std::string name = "Remap " + std::to_string(i + 1);
+                cat->add(button_combo_item::create(name + " from",
+                                                   remaps[i].from,
+                                                   defaults::remap.from));
+                cat->add(button_combo_item::create(name + " to",
+                                                   remaps[i].to,
+                                                   defaults::remap.to));
+            }
+            cat->add(int_item::create("Left stick to D-pad (%, 0 = off)",
+                                      left_stick_dpad,
+                                      defaults::stick_dpad,
+                                      0, 100));
+            cat->add(int_item::create("Right stick to D-pad (%, 0 = off)",
+                                      right_stick_dpad,
+                                      defaults::stick_dpad,
+                                      0, 100));
+            root.add(std::move(cat));
+        }
+
+        root.add(bool_item::create("Capture input to SD card",
+                                   capture,
+                                   defaults::capture,
+                                   "yes", "no"));
+
+        root.add(int_item::create("Time budget (us, 0 = no limit)",
+                                  time_budget,
+                                  defaults::time_budget,
+                                  0, 10000));
+
+        // Read-only: what the hooks measured since the plugin was loaded.
+        for (const auto& [label, text] : stats::report())
+            root.add(text_item::create(label, text));
+
         root.add(reset_turbo_item::create());
     }
 
@@ -127,6 +534,11 @@ namespace cfg {
     void
     menu_close()
     {
+        if (menu_edits_game_rate && game_rate != snapshot::effective_rate())
+            snapshot::set_rate_override(game_rate);
+        snapshot::publish();
+        hooks::update();
+
         try {
             save();
             logger::finalize();
@@ -144,6 +556,7 @@ namespace cfg {
         wups::config::init(PACKAGE_NAME, menu_open, menu_close);
 
         cfg::load();
+        profiles::load();
     }
 
 } // namespace cfg
@@ -10,21 +10,68 @@
 #define CFG_HPP
 
 #include <array>
+#include <mutex>
 
 #include <wupsxx/button_combo.hpp>
 
 
 namespace cfg {
 
-    inline constexpr unsigned max_toggle_combos = 4;
+    inline constexpr unsigned max_toggle_combos = 8;
+
+    inline constexpr unsigned max_patterns = 4;
+
+    inline constexpr unsigned max_remaps = 8;
+
+
+    // Turbo pattern for some buttons, measured in steps (half a plain turbo cycle).
+    struct pattern {
+        wups::utils::button_combo buttons;
+        int cycle = 2; // steps in one press and release
+        int duty  = 1; // steps pressed, in each cycle
+        int burst = 0; // presses, then wait for the button to be released; 0 = no limit
+        int phase = 0; // step where the pattern starts
+    };
+
+
+    // Every button in "from" is replaced by all the buttons in "to".
+    struct button_remap {
+        wups::utils::button_combo from;
+        wups::utils::button_combo to;
+    };
+
 
     extern bool enabled;
     extern int period;
+    extern int rate;
+    extern bool immediate;
+    extern int turbo_sync; // 0 = off, 1 = per controller, 2 = all controllers
+    extern bool remember_turbo;
+    extern bool remember_rate;
     extern std::array<wups::utils::button_combo,
                       max_toggle_combos> toggle_combo;
+    extern std::array<pattern, max_patterns> patterns;
+    extern wups::utils::button_combo record_combo;
+    extern wups::utils::button_combo play_combo;
+    extern bool capture;
+    extern std::array<button_remap, max_remaps> remaps;
+    extern int left_stick_dpad;  // percent of the stick range; 0 = disabled
+    extern int right_stick_dpad;
+    extern int time_budget; // microseconds per sample; 0 = no limit
+
+    // The storage is used by the menu, the application and the worker thread.
+    extern std::mutex storage_mutex;
+
 
     void init();
 
+    // Note that the storage was changed; call it with storage_mutex locked.
+    void touch();
+
+    // Write the storage to the SD card, if it changed; unless forced, only after it
+    // stopped changing for a while. Called from the worker thread.
+    void flush(bool force = false);
+
 } // namespace cfg
 
 #endif
@@ -0,0 +1,80 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <variant>
+
+#include <wupsxx/button_combo.hpp>
+
+#include "combo.hpp"
+
+
+using std::uint32_t;
+
+namespace utils = wups::utils;
+
+
+namespace combo {
+
+    void
+    table::add(const pattern& p)
+        noexcept
+    {
+        if (!p.core && !p.ext)
+            return;
+        if (size == patterns.size()) [[unlikely]]
+            return;
+        patterns[size++] = p;
+        any_core |= p.core;
+        any_ext  |= p.ext;
+    }
+
+
+    void
+    compile(table_set& result)
+    {
+        result = {};
+
+        auto at = [&result](notify::pad family) -> table&
+        {
+            return result[static_cast<unsigned>(family)];
+        };
+
+        auto add = [&at](const utils::button_combo& combo,
+                         action what)
+        {
+            if (auto bs = get_if<utils::vpad::button_set>(&combo)) {
+                at(notify::pad::vpad).add({bs->buttons, 0, what});
+                return;
+            }
+
+            const auto& bs = get<utils::wpad::button_set>(combo);
+            const uint32_t core = bs.core.buttons;
+
+            if (auto x = get_if<utils::wpad::nunchuk::button_set>(&bs.ext))
+                // Note: nunchuk buttons are stored together with the core buttons.
+                at(notify::pad::wpad_nunchuk).add({core | x->buttons, 0, what});
+            else if (auto x = get_if<utils::wpad::classic::button_set>(&bs.ext))
+                at(notify::pad::wpad_classic).add({core, x->buttons, what});
+            else if (auto x = get_if<utils::wpad::pro::button_set>(&bs.ext))
+                at(notify::pad::wpad_pro).add({core, x->buttons, what});
+            else
+                // Combos with only core buttons work with any extension.
+                for (auto family : {notify::pad::wpad_core,
+                                    notify::pad::wpad_nunchuk,
+                                    notify::pad::wpad_classic,
+                                    notify::pad::wpad_pro})
+                    at(family).add({core, 0, what});
+        };
+
+        for (const auto& combo : cfg::toggle_combo)
+            add(combo, action::toggle);
+        add(cfg::record_combo, action::record);
+        add(cfg::play_combo, action::play);
+    }
+
+} // namespace combo
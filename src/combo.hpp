@@ -0,0 +1,89 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef COMBO_HPP
+#define COMBO_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "cfg.hpp"
+#include "notify.hpp"
+
+
+/*
+ * The toggle and macro combos, compiled into one table per controller family.
+ *
+ * A combo is triggered when all its buttons are held, and at least one of them was just
+ * pressed. Since nothing can trigger unless a combo button was pressed, the union of all
+ * combos rejects most samples with a single test, no matter how many combos there are.
+ */
+
+namespace combo {
+
+    // What a combo does.
+    enum class action : std::uint8_t {
+        none,
+        toggle,         // enter or leave the toggling state
+        record,         // start or stop recording the macro
+        play,           // start or stop playing the macro
+    };
+
+
+    struct pattern {
+        std::uint32_t core = 0;
+        std::uint32_t ext  = 0; // only used by the classic and pro families
+        action        what = action::toggle;
+    };
+
+
+    struct table {
+
+        std::uint32_t any_core = 0;
+        std::uint32_t any_ext  = 0;
+        unsigned      size     = 0;
+        std::array<pattern, cfg::max_toggle_combos + 2> patterns;
+
+
+        void add(const pattern& p) noexcept;
+
+
+        // The first combo triggered by this sample, in config order.
+        action
+        triggered(std::uint32_t hold,
+                  std::uint32_t trigger,
+                  std::uint32_t ext_hold = 0,
+                  std::uint32_t ext_trigger = 0)
+            const noexcept
+        {
+            if (!((trigger & any_core) | (ext_trigger & any_ext))) [[likely]]
+                return action::none;
+
+            for (unsigned i = 0; i < size; ++i) {
+                const pattern& p = patterns[i];
+                if ((hold & p.core) == p.core
+                    && (ext_hold & p.ext) == p.ext
+                    && ((trigger & p.core) | (ext_trigger & p.ext)))
+                    return p.what;
+            }
+            return action::none;
+        }
+
+    };
+
+
+    // Indexed by notify::pad.
+    using table_set = std::array<table, 5>;
+
+
+    // Build the tables from cfg::toggle_combo, cfg::record_combo and cfg::play_combo.
+    void compile(table_set& result);
+
+} // namespace combo
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <mutex>
+
+#include <wupsxx/logger.hpp>
+
+#include "hooks.hpp"
+
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+
+namespace logger = wups::logger;
+
+
+namespace hooks {
+
+    // The menu and the worker thread can both update the hooks.
+    std::mutex mutex;
+
+
+    patch::patch(const function_replacement_data_t& data)
+        noexcept :
+        data(data)
+    {}
+
+
+    bool
+    patch::installed()
+        const noexcept
+    {
+        return handle;
+    }
+
+
+    void
+    patch::install()
+    {
+        if (handle)
+            return;
+        bool patched = false;
+        auto status = FunctionPatcher_AddFunctionPatch(&data, &handle, &patched);
+        if (status != FUNCTION_PATCHER_RESULT_SUCCESS) {
+            logger::printf("Failed to install hook for %s: %s\n",
+                           data.ReplaceInRPL.function_name,
+                           FunctionPatcher_GetStatusStr(status));
+            handle = 0;
+        }
+    }
+
+
+    void
+    patch::remove()
+    {
+        if (!handle)
+            return;
+        auto status = FunctionPatcher_RemoveFunctionPatch(handle);
+        if (status != FUNCTION_PATCHER_RESULT_SUCCESS)
+            logger::printf("Failed to remove hook for %s: %s\n",
+                           data.ReplaceInRPL.function_name,
+                           FunctionPatcher_GetStatusStr(status));
+        handle = 0;
+    }
+
+
+    void
+    update()
+    {
+        std::lock_guard guard{mutex};
+        vpad::update_hook();
+        wpad::update_hook();
+    }
+
+
+    void
+    remove()
+    {
+        std::lock_guard guard{mutex};
+        vpad::remove_hook();
+        wpad::remove_hook();
+    }
+
+} // namespace hooks
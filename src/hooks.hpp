@@ -0,0 +1,52 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef HOOKS_HPP
+#define HOOKS_HPP
+
+#include <function_patcher/function_patching.h>
+
+
+/*
+ * The input hooks are installed at runtime, the first time they're needed. From then on,
+ * they stay installed until the title ends: a game thread may be inside a hook at any
+ * time, and removing the patch would free the trampoline it returns through. While
+ * there's nothing for a hook to do, it returns right after the real function.
+ */
+
+namespace hooks {
+
+    // One function replacement, that can be installed and removed.
+    class patch {
+
+        function_replacement_data_t data;
+        PatchedFunctionHandle handle = 0;
+
+    public:
+
+        patch(const function_replacement_data_t& data) noexcept;
+
+        bool installed() const noexcept;
+
+        void install();
+
+        void remove();
+
+    };
+
+
+    // Install or activate each hook when it's needed, and deactivate it when it's not.
+    void update();
+
+    // Deactivate all hooks, wait for them to return, and remove them; only when the title
+    // ends.
+    void remove();
+
+} // namespace hooks
+
+#endif
@@ -0,0 +1,119 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef LOCKFREE_HPP
+#define LOCKFREE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+
+/*
+ * Lock-free ways to share the per-channel state, which is owned by the input hooks.
+ *
+ * Other threads never write to the state directly: they post a request, that the hook
+ * applies on its next sample. What other threads need to know is published by the hook
+ * through a seqlock.
+ */
+
+namespace lockfree {
+
+    // A request to all channels; can be posted from any thread.
+    class request {
+
+        std::atomic<std::uint8_t> counter = 0;
+
+    public:
+
+        void
+        post()
+            noexcept
+        {
+            counter.fetch_add(1, std::memory_order_release);
+        }
+
+
+        // Only the hook can call this: true if there's a request the channel didn't see yet.
+        bool
+        take(std::uint8_t& seen)
+            noexcept
+        {
+            const std::uint8_t current = counter.load(std::memory_order_acquire);
+            if (current == seen) [[likely]]
+                return false;
+            seen = current;
+            return true;
+        }
+
+    };
+
+
+    // One writer, many readers; readers retry until they get a consistent copy.
+    template<typename T>
+    class seqlock {
+
+        static_assert(std::is_trivially_copyable_v<T>);
+
+        static constexpr unsigned num_words = (sizeof(T) + 3) / 4;
+
+        using buffer = std::array<std::uint32_t, num_words>;
+
+        std::atomic<std::uint32_t> seq = 0;
+        std::array<std::atomic<std::uint32_t>, num_words> words{};
+
+    public:
+
+        // Only the writer can call this.
+        void
+        store(const T& value)
+            noexcept
+        {
+            buffer buf{};
+            std::memcpy(buf.data(), &value, sizeof(T));
+
+            const std::uint32_t s = seq.load(std::memory_order_relaxed);
+            seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (unsigned i = 0; i < num_words; ++i)
+                words[i].store(buf[i], std::memory_order_relaxed);
+            seq.store(s + 2, std::memory_order_release);
+        }
+
+
+        T
+        load()
+            const noexcept
+        {
+            buffer buf;
+            for (;;) {
+                const std::uint32_t s = seq.load(std::memory_order_acquire);
+                if (!(s & 1)) {
+                    for (unsigned i = 0; i < num_words; ++i)
+                        buf[i] = words[i].load(std::memory_order_relaxed);
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (seq.load(std::memory_order_relaxed) == s)
+                        break;
+                }
+                // The writer may be waiting for this core.
+                std::this_thread::yield();
+            }
+
+            T value;
+            std::memcpy(static_cast<void*>(&value), buf.data(), sizeof(T));
+            return value;
+        }
+
+    };
+
+} // namespace lockfree
+
+#endif
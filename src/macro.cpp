@@ -0,0 +1,123 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "macro.hpp"
+
+#include "trace.hpp"
+
+
+namespace macro {
+
+    namespace {
+
+        void
+        post(notify::what kind,
+             trace::kind tkind,
+             notify::pad source,
+             unsigned channel,
+             std::uint32_t value = 0)
+            noexcept
+        {
+            notify::post({
+                    .source  = source,
+                    .kind    = kind,
+                    .channel = static_cast<std::uint8_t>(channel),
+                    .button  = value
+                });
+            trace::record(tkind, source, channel, value);
+        }
+
+    } // namespace
+
+
+    void
+    on_combo(tape& t,
+             combo::action what,
+             notify::pad source,
+             unsigned channel,
+             std::uint8_t ext_type)
+        noexcept
+    {
+        const auto was = t.state;
+        stop(t, source, channel);
+
+        switch (what) {
+
+        case combo::action::record:
+            // The record combo also stops playing, without starting a new recording.
+            if (was == tape::mode::idle) {
+                t.start_recording(ext_type);
+                post(notify::what::recording, trace::kind::recording, source, channel);
+            }
+            break;
+
+        case combo::action::play:
+            if (was == tape::mode::playing)
+                break;
+            if (t.ext_type != ext_type || !t.start_playing()) {
+                post(notify::what::no_macro, trace::kind::no_macro, source, channel);
+                break;
+            }
+            post(notify::what::playing, trace::kind::playing, source, channel);
+            break;
+
+        default:
+            break;
+
+        }
+    }
+
+
+    void
+    stop(tape& t,
+         notify::pad source,
+         unsigned channel)
+        noexcept
+    {
+        switch (t.state) {
+        case tape::mode::idle:
+            return;
+        case tape::mode::recording:
+            t.stop();
+            post(notify::what::recorded, trace::kind::recorded, source, channel, t.length());
+            return;
+        case tape::mode::playing:
+            t.stop();
+            post(notify::what::played, trace::kind::played, source, channel);
+            return;
+        }
+    }
+
+
+    void
+    record(tape& t,
+           const sample& s,
+           notify::pad source,
+           unsigned channel)
+        noexcept
+    {
+        if (!t.record(s)) [[unlikely]]
+            stop(t, source, channel);
+    }
+
+
+    sample
+    play(tape& t,
+         turbo::edges& core,
+         turbo::edges& ext,
+         notify::pad source,
+         unsigned channel)
+        noexcept
+    {
+        const sample result = t.play(core, ext);
+        if (t.idle()) [[unlikely]]
+            post(notify::what::played, trace::kind::played, source, channel);
+        return result;
+    }
+
+} // namespace macro
@@ -0,0 +1,205 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MACRO_HPP
+#define MACRO_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "combo.hpp"
+#include "notify.hpp"
+#include "turbo.hpp"
+
+
+/*
+ * Input macros: a timed sequence of buttons, recorded from a channel and played back on
+ * it, one sample at a time.
+ *
+ * The sequence is stored as runs of identical samples, in a fixed buffer owned by the
+ * hook, so recording and playing never allocate.
+ */
+
+namespace macro {
+
+    // Enough for about 4 minutes of a button changing every 4 samples, at 60 samples/s.
+    inline constexpr unsigned max_runs = 256;
+
+
+    // Buttons of one sample; "ext" is only used by the classic and pro extensions.
+    struct sample {
+        std::uint32_t core = 0;
+        std::uint32_t ext  = 0;
+
+        bool operator ==(const sample&) const noexcept = default;
+    };
+
+
+    class tape {
+
+        struct run {
+            sample        buttons;
+            std::uint16_t length = 0; // how many samples
+        };
+
+        std::array<run, max_runs> runs;
+        std::uint16_t size   = 0; // runs recorded
+        std::uint16_t pos    = 0; // run being played
+        std::uint16_t offset = 0; // samples already played from runs[pos]
+        sample        last;       // buttons shown in the last sample played
+
+    public:
+
+        enum class mode : std::uint8_t {
+            idle,
+            recording,
+            playing,
+        };
+
+        mode         state    = mode::idle;
+        std::uint8_t ext_type = 0; // the extension it was recorded with
+
+
+        bool
+        idle()
+            const noexcept
+        {
+            return state == mode::idle;
+        }
+
+
+        // How many samples were recorded.
+        std::uint32_t
+        length()
+            const noexcept
+        {
+            std::uint32_t result = 0;
+            for (unsigned i = 0; i < size; ++i)
+                result += runs[i].length;
+            return result;
+        }
+
+
+        void
+        start_recording(std::uint8_t new_ext_type = 0)
+            noexcept
+        {
+            state    = mode::recording;
+            ext_type = new_ext_type;
+            size     = 0;
+        }
+
+
+        // Append one sample; returns false when the tape is full.
+        bool
+        record(const sample& s)
+            noexcept
+        {
+            if (size) {
+                run& r = runs[size - 1];
+                if (r.buttons == s && r.length < UINT16_MAX) [[likely]] {
+                    ++r.length;
+                    return true;
+                }
+            }
+            if (size == runs.size()) [[unlikely]]
+                return false;
+            runs[size++] = {s, 1};
+            return true;
+        }
+
+
+        // Returns false if there's nothing to play.
+        bool
+        start_playing()
+            noexcept
+        {
+            if (!size)
+                return false;
+            state  = mode::playing;
+            pos    = 0;
+            offset = 0;
+            last   = {};
+            return true;
+        }
+
+
+        void
+        stop()
+            noexcept
+        {
+            state = mode::idle;
+        }
+
+
+        // The buttons for the next sample, and their edges against the previous one. After
+        // the last run, one more sample releases everything, then the tape stops.
+        sample
+        play(turbo::edges& core,
+             turbo::edges& ext)
+            noexcept
+        {
+            sample s;
+            if (pos < size) [[likely]] {
+                s = runs[pos].buttons;
+                if (++offset == runs[pos].length) {
+                    ++pos;
+                    offset = 0;
+                }
+            } else
+                stop();
+
+            core = turbo::track(last.core, s.core);
+            ext  = turbo::track(last.ext, s.ext);
+            return s;
+        }
+
+    };
+
+
+    /*
+     * These are called by the hooks; they drive the tape of one channel, and notify the
+     * user about it.
+     */
+
+    // Start or stop recording or playing, when a macro combo is triggered.
+    void
+    on_combo(tape& t,
+             combo::action what,
+             notify::pad source,
+             unsigned channel,
+             std::uint8_t ext_type = 0)
+        noexcept;
+
+    // Stop recording or playing.
+    void
+    stop(tape& t,
+         notify::pad source,
+         unsigned channel)
+        noexcept;
+
+    // Record one sample; recording stops when the tape is full.
+    void
+    record(tape& t,
+           const sample& s,
+           notify::pad source,
+           unsigned channel)
+        noexcept;
+
+    // Play one sample.
+    sample
+    play(tape& t,
+         turbo::edges& core,
+         turbo::edges& ext,
+         notify::pad source,
+         unsigned channel)
+        noexcept;
+
+} // namespace macro
+
+#endif
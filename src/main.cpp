@@ -9,13 +9,18 @@
 #include <cstdint>
 #include <stdexcept>
 
+#include <function_patcher/function_patching.h>
 #include <notifications/notifications.h>
 #include <wups.h>
 
 #include <wupsxx/logger.hpp>
 
 #include "cfg.hpp"
+#include "hooks.hpp"
+#include "profiles.hpp"
+#include "snapshot.hpp"
 #include "vpad.hpp"
+#include "worker.hpp"
 #include "wpad.hpp"
 
 #ifdef HAVE_CONFIG_H
@@ -44,6 +49,9 @@ INITIALIZE_PLUGIN()
         auto notify_status = NotificationModule_InitLibrary();
         if (notify_status != NOTIFICATION_MODULE_RESULT_SUCCESS)
             throw std::runtime_error{NotificationModule_GetStatusStr(notify_status)};
+        auto patcher_status = FunctionPatcher_InitLibrary();
+        if (patcher_status != FUNCTION_PATCHER_RESULT_SUCCESS)
+            throw std::runtime_error{FunctionPatcher_GetStatusStr(patcher_status)};
         cfg::init();
     }
     catch (std::exception& e) {
@@ -54,6 +62,8 @@ INITIALIZE_PLUGIN()
 
 DEINITIALIZE_PLUGIN()
 {
+    hooks::remove();
+    FunctionPatcher_DeInitLibrary();
     NotificationModule_DeInitLibrary();
 }
 
@@ -61,11 +71,19 @@ DEINITIALIZE_PLUGIN()
 ON_APPLICATION_START()
 {
     logger::initialize(PACKAGE_NAME);
+    worker::initialize();
+    profiles::apply();
+    // The game's profile may have changed the config.
+    snapshot::publish();
+    hooks::update();
 }
 
 
 ON_APPLICATION_ENDS()
 {
+    hooks::remove();
+    profiles::store();
+    worker::finalize();
     vpad::reset();
     wpad::reset();
     logger::finalize();
@@ -6,20 +6,28 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>
+#include <array>
 #include <cstdio>
 #include <string>
 
 #include <notifications/notifications.h>
 
+#include <wupsxx/button_combo.hpp>
 #include <wupsxx/logger.hpp>
 
 #include "notify.hpp"
 
+#include "ring.hpp"
+
 #ifdef HAVE_CONFIG_H
 #include <config.h>
 #endif
 
 
+namespace logger = wups::logger;
+
+
 namespace notify {
 
     const std::string prefix = "[" PACKAGE_NAME "] ";
@@ -29,6 +37,8 @@ namespace notify {
     const NMColor fg_color = {0xff, 0xff, 0xff, 0xff};
     const NMColor bg_color = {0x10, 0x10, 0x40, 0xff};
 
+    ring<event, 16> pending;
+
 
     void
     info(const char* fmt, ...)
@@ -74,4 +84,166 @@ namespace notify {
         }
     }
 
+
+    void
+    post(const event& ev)
+        noexcept
+    {
+        pending.push(ev);
+    }
+
+
+    wups::utils::wpad::button_set
+    make_button_set(pad source,
+                    std::uint32_t button)
+    {
+        namespace wpad = wups::utils::wpad;
+        switch (source) {
+        case pad::wpad_nunchuk:
+            return wpad::ext_button_set{wpad::nunchuk::button_set{
+                    static_cast<WPADNunchukButton>(button)}};
+        case pad::wpad_classic:
+            return wpad::ext_button_set{wpad::classic::button_set{
+                    static_cast<WPADClassicButton>(button)}};
+        case pad::wpad_pro:
+            return wpad::ext_button_set{wpad::pro::button_set{
+                    static_cast<WPADProButton>(button)}};
+        default:
+            return wpad::core::button_set{static_cast<WPADButton>(button)};
+        }
+    }
+
+
+    std::string
+    to_string(pad source,
+              std::uint32_t button)
+    {
+        if (source == pad::vpad)
+            return to_string(wups::utils::vpad::button_set{static_cast<VPADButtons>(button)});
+        return to_string(make_button_set(source, button));
+    }
+
+
+    std::string
+    to_glyph(pad source,
+             std::uint32_t button)
+    {
+        if (source == pad::vpad)
+            return to_glyph(wups::utils::vpad::button_set{static_cast<VPADButtons>(button)});
+        return to_glyph(make_button_set(source, button));
+    }
+
+
+    void
+    show(const event& ev)
+    {
+        switch (ev.kind) {
+
+        case what::toggling:
+            info("Toggling turbo...");
+            break;
+
+        case what::canceled:
+            info("Canceled turbo toggle.");
+            break;
+
+        case what::turbo:
+        case what::normal:
+            info("%s = %s",
+                 to_glyph(ev.source, ev.button).c_str(),
+                 ev.kind == what::turbo ? "turbo" : "normal");
+            break;
+
+        case what::recording:
+            info("Recording macro...");
+            break;
+
+        case what::recorded:
+            info("Recorded macro: %u samples.", unsigned{ev.button});
+            break;
+
+        case what::playing:
+            info("Playing macro...");
+            break;
+
+        case what::played:
+            info("Stopped macro.");
+            break;
+
+        case what::no_macro:
+            info("No macro recorded for this controller.");
+            break;
+
+        }
+    }
+
+
+    // Events that replace each other: only the last state of each group is shown.
+    enum class group {
+        button,
+        toggle,
+        macro,
+    };
+
+
+    group
+    group_of(what kind)
+    {
+        switch (kind) {
+        case what::toggling:
+        case what::canceled:
+            return group::toggle;
+        case what::turbo:
+        case what::normal:
+            return group::button;
+        default:
+            return group::macro;
+        }
+    }
+
+
+    // Two events with the same key replace each other: only the last one is shown.
+    bool
+    same_key(const event& a,
+             const event& b)
+    {
+        if (a.source != b.source || a.channel != b.channel)
+            return false;
+        const group ga = group_of(a.kind);
+        if (ga != group_of(b.kind))
+            return false;
+        if (ga == group::button)
+            return a.button == b.button;
+        return true;
+    }
+
+
+    // Show all pending events, collapsing the repeated ones.
+    void
+    flush()
+    {
+        std::array<event, decltype(pending)::capacity> batch;
+        unsigned size = 0;
+        while (size < batch.size()) {
+            auto ev = pending.pop();
+            if (!ev)
+                break;
+            batch[size++] = *ev;
+        }
+
+        for (unsigned i = 0; i < size; ++i) {
+            bool superseded = std::any_of(batch.begin() + i + 1,
+                                          batch.begin() + size,
+                                          [&](const event& later)
+                                          {
+                                              return same_key(batch[i], later);
+                                          });
+            if (!superseded)
+                show(batch[i]);
+        }
+
+        if (auto dropped = pending.take_dropped())
+            logger::printf("Dropped %u notifications.\n", unsigned{dropped});
+    }
+
 } // namespace notify
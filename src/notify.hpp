@@ -10,6 +10,8 @@
 #define NOTIFY_HPP
 
 #include <cstdarg>
+#include <cstdint>
+#include <string>
 
 
 namespace notify {
@@ -19,6 +21,51 @@ namespace notify {
 
     void vinfo(const char* fmt, std::va_list args) noexcept;
 
+
+    // Which kind of controller (or extension) an event refers to.
+    enum class pad : std::uint8_t {
+        vpad,
+        wpad_core,
+        wpad_nunchuk,
+        wpad_classic,
+        wpad_pro,
+    };
+
+
+    enum class what : std::uint8_t {
+        toggling,       // entered the toggling state
+        canceled,       // left the toggling state without toggling a button
+        turbo,          // button was set to turbo
+        normal,         // button was set to normal
+        recording,      // started recording a macro
+        recorded,       // stopped recording a macro
+        playing,        // started playing a macro
+        played,         // stopped playing a macro
+        no_macro,       // nothing recorded for this controller
+    };
+
+
+    struct event {
+        pad           source;
+        what          kind;
+        std::uint8_t  channel;
+        std::uint32_t button; // native button bit for turbo/normal, samples for recorded
+    };
+
+
+    // Queue a notification, to be shown by the worker thread; doesn't block, doesn't
+    // allocate, so it's safe to call from the input hooks.
+    void post(const event& ev) noexcept;
+
+
+    // Show all posted notifications; called from the worker thread.
+    void flush();
+
+
+    // Name and glyph of a native button bit.
+    std::string to_string(pad source, std::uint32_t button);
+    std::string to_glyph(pad source, std::uint32_t button);
+
 } // namespace notify
 
 #endif
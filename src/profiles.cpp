@@ -0,0 +1,265 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <coreinit/title.h>
+#include <wups/storage.h>
+
+#include <wupsxx/logger.hpp>
+
+#include "profiles.hpp"
+
+#include "cfg.hpp"
+#include "snapshot.hpp"
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace logger = wups::logger;
+
+
+/*
+ * All profiles are stored in a single binary item: a header, followed by the records
+ * sorted by title ID. They're read once when the plugin is loaded, so starting a title
+ * only does a binary search in memory.
+ */
+
+namespace profiles {
+
+    const char* const key = "profiles";
+
+    constexpr uint32_t magic = 0x54425046; // "TBPF"
+
+    constexpr uint16_t version = 1;
+
+    // Limit the size of the storage item.
+    constexpr unsigned max_records = 512;
+
+
+    struct header_t {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t record_size;
+        uint32_t count;
+    };
+
+
+    struct record_t {
+        uint64_t     title_id;
+        std::int8_t  rate;      // negative when the rate is not remembered
+        std::uint8_t reserved;
+        std::array<uint16_t, vpad::max_vpads> vpad;
+        std::array<wpad::turbo_set, wpad::max_wpads> wpad;
+
+        bool operator ==(const record_t&) const noexcept = default;
+    };
+    static_assert(sizeof(record_t) == 72);
+
+
+    // Sorted by title_id.
+    std::vector<record_t> records;
+
+    std::vector<record_t>::iterator
+    find(uint64_t title_id)
+    {
+        return std::lower_bound(records.begin(), records.end(),
+                                title_id,
+                                [](const record_t& rec, uint64_t id)
+                                {
+                                    return rec.title_id < id;
+                                });
+    }
+
+
+    bool
+    found(std::vector<record_t>::iterator it,
+          uint64_t title_id)
+    {
+        return it != records.end() && it->title_id == title_id;
+    }
+
+
+    void
+    load()
+    {
+        std::lock_guard guard{cfg::storage_mutex};
+
+        records.clear();
+
+        uint32_t size = 0;
+        auto status = WUPSStorageAPI_GetItemSize(nullptr, key,
+                                                 WUPS_STORAGE_ITEM_BINARY,
+                                                 &size);
+        if (status == WUPS_STORAGE_ERROR_NOT_FOUND)
+            return;
+        if (status != WUPS_STORAGE_ERROR_SUCCESS) {
+            logger::printf("Failed to read profiles: %s\n",
+                           WUPSStorageAPI_GetStatusStr(status));
+            return;
+        }
+        if (size < sizeof(header_t))
+            return;
+
+        std::vector<std::uint8_t> blob(size);
+        status = WUPSStorageAPI_GetItem(nullptr, key,
+                                        WUPS_STORAGE_ITEM_BINARY,
+                                        blob.data(), blob.size(),
+                                        &size);
+        if (status != WUPS_STORAGE_ERROR_SUCCESS) {
+            logger::printf("Failed to read profiles: %s\n",
+                           WUPSStorageAPI_GetStatusStr(status));
+            return;
+        }
+
+        header_t header;
+        std::memcpy(&header, blob.data(), sizeof header);
+        if (header.magic != magic
+            || header.version != version
+            || header.record_size != sizeof(record_t)
+            || header.count > max_records
+            || size != sizeof header + header.count * sizeof(record_t)) {
+            logger::printf("Ignoring invalid profiles.\n");
+            return;
+        }
+
+        records.resize(header.count);
+        std::memcpy(static_cast<void*>(records.data()),
+                    blob.data() + sizeof header,
+                    header.count * sizeof(record_t));
+
+        // Don't trust the order, a single unsorted record would break the search.
+        std::ranges::sort(records, {}, &record_t::title_id);
+        auto dups = std::ranges::unique(records, {}, &record_t::title_id);
+        records.erase(dups.begin(), dups.end());
+    }
+
+
+    void
+    apply()
+    {
+        // Note: the remembered rate only lasts for this title, cfg::rate stays the global
+        // one.
+        snapshot::set_rate_override(-1);
+
+        if (!cfg::remember_turbo && !cfg::remember_rate)
+            return;
+
+        const uint64_t title_id = OSGetTitleID();
+        auto it = find(title_id);
+        if (!found(it, title_id))
+            return;
+
+        if (cfg::remember_turbo) {
+            for (unsigned i = 0; i < vpad::max_vpads; ++i)
+                vpad::set_turbo(i, it->vpad[i]);
+            for (unsigned i = 0; i < wpad::max_wpads; ++i)
+                wpad::set_turbo(i, it->wpad[i]);
+        }
+
+        if (cfg::remember_rate && it->rate >= 0)
+            snapshot::set_rate_override(it->rate);
+    }
+
+
+    void
+    save()
+    {
+        std::vector<std::uint8_t> blob(sizeof(header_t) + records.size() * sizeof(record_t));
+
+        const header_t header = {
+            .magic       = magic,
+            .version     = version,
+            .record_size = sizeof(record_t),
+            .count       = static_cast<uint32_t>(records.size())
+        };
+        std::memcpy(blob.data(), &header, sizeof header);
+        std::memcpy(blob.data() + sizeof header,
+                    records.data(),
+                    records.size() * sizeof(record_t));
+
+        std::lock_guard guard{cfg::storage_mutex};
+        auto status = WUPSStorageAPI_StoreItem(nullptr, key,
+                                               WUPS_STORAGE_ITEM_BINARY,
+                                               blob.data(), blob.size());
+        if (status != WUPS_STORAGE_ERROR_SUCCESS) {
+            logger::printf("Failed to save profiles: %s\n",
+                           WUPSStorageAPI_GetStatusStr(status));
+            return;
+        }
+        // The worker thread writes it to the SD card.
+        cfg::touch();
+    }
+
+
+    void
+    store()
+    {
+        if (!cfg::remember_turbo && !cfg::remember_rate)
+            return;
+
+        // Note: the turbo buttons come from the hooks; when they didn't run for this title,
+        // there's nothing new to remember.
+        if (!snapshot::enabled())
+            return;
+        if (!vpad::hook_ran() && !wpad::hook_ran())
+            return;
+
+        record_t rec{};
+        rec.title_id = OSGetTitleID();
+        // The global rate is not remembered, so a title doesn't keep it when it changes.
+        const int rate = snapshot::effective_rate();
+        rec.rate = cfg::remember_rate && rate != cfg::rate ? rate : -1;
+
+        bool empty = rec.rate < 0;
+        if (cfg::remember_turbo) {
+            for (unsigned i = 0; i < vpad::max_vpads; ++i) {
+                rec.vpad[i] = vpad::get_turbo(i);
+                if (rec.vpad[i])
+                    empty = false;
+            }
+            for (unsigned i = 0; i < wpad::max_wpads; ++i) {
+                const auto t = wpad::get_turbo(i);
+                rec.wpad[i] = t;
+                if (t.core || t.nunchuk || t.classic || t.pro)
+                    empty = false;
+            }
+        }
+
+        auto it = find(rec.title_id);
+        const bool existed = found(it, rec.title_id);
+        if (existed) {
+            if (*it == rec)
+                return;
+            if (empty)
+                records.erase(it);
+            else
+                *it = rec;
+        } else {
+            if (empty)
+                return;
+            if (records.size() >= max_records) {
+                logger::printf("Too many profiles, not storing this one.\n");
+                return;
+            }
+            records.insert(it, rec);
+        }
+
+        save();
+    }
+
+} // namespace profiles
@@ -0,0 +1,29 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef PROFILES_HPP
+#define PROFILES_HPP
+
+
+// Turbo buttons (and optionally the rate) remembered for each title.
+
+namespace profiles {
+
+    // Read all profiles from the storage; called once, when the plugin is loaded.
+    void load();
+
+    // Restore the profile of the running title; called when the application starts.
+    void apply();
+
+    // Update the profile of the running title; called when the application ends, before
+    // the turbos are reset, and before the worker thread writes the storage.
+    void store();
+
+} // namespace profiles
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#include "pulse.hpp"
+
+#include "cfg.hpp"
+
+
+using std::uint32_t;
+
+namespace utils = wups::utils;
+
+
+namespace pulse {
+
+    // When the first press is immediate, skip the released steps at the start.
+    void
+    anchor(turbo::pattern& pat)
+    {
+        if (!pat.bits || (pat.bits & 1))
+            return;
+        const unsigned skip = std::countr_zero(pat.bits);
+        if (pat.loop) {
+            const std::uint64_t all = (std::uint64_t{1} << pat.length) - 1;
+            pat.bits = ((pat.bits >> skip) | (pat.bits << (pat.length - skip))) & all;
+        } else {
+            pat.bits >>= skip;
+            pat.length -= skip;
+        }
+    }
+
+
+    turbo::pattern
+    make_pattern(const cfg::pattern& p)
+    {
+        constexpr unsigned max_length = 63;
+
+        const unsigned cycle = std::clamp(p.cycle, 1, int{max_length});
+        const unsigned duty  = std::clamp(p.duty, 0, int(cycle));
+        const unsigned phase = std::max(p.phase, 0) % cycle;
+        // Note: the whole burst must fit in a pattern, so long cycles allow fewer presses.
+        const unsigned burst = std::min<unsigned>(std::max(p.burst, 0), max_length / cycle);
+
+        turbo::pattern result;
+        result.lead = 0;
+        if (burst) {
+            // Only this many presses, then stay released until the button is pressed again.
+            result.loop   = false;
+            result.length = burst * cycle - phase;
+        } else {
+            result.loop   = true;
+            result.length = cycle;
+        }
+
+        result.bits = 0;
+        for (unsigned i = 0; i < result.length; ++i)
+            if ((i + phase) % cycle < duty)
+                result.bits |= std::uint64_t{1} << i;
+
+        if (cfg::immediate)
+            anchor(result);
+
+        return result;
+    }
+
+
+    void
+    compile(table_set& result)
+    {
+        result = {};
+        if (cfg::immediate) {
+            // The plain turbo starts pressed, on the same sample the button is pressed.
+            const turbo::pattern plain = {
+                .bits   = 0b01,
+                .length = 2,
+                .loop   = true,
+                .lead   = 0
+            };
+            for (auto& set : result)
+                set.fill(plain);
+        }
+        // Buttons that already got a pattern; the first pattern listing a button wins.
+        std::array<uint32_t, 5> assigned{};
+
+        auto assign = [&](notify::pad family,
+                          uint32_t buttons,
+                          const turbo::pattern& pat)
+        {
+            const unsigned f = static_cast<unsigned>(family);
+            buttons &= ~assigned[f];
+            assigned[f] |= buttons;
+            for (; buttons; buttons &= buttons - 1)
+                result[f][std::countr_zero(buttons)] = pat;
+        };
+
+        for (const auto& p : cfg::patterns) {
+
+            const auto pat = make_pattern(p);
+
+            if (auto bs = get_if<utils::vpad::button_set>(&p.buttons)) {
+                assign(notify::pad::vpad, bs->buttons, pat);
+                continue;
+            }
+
+            const auto& bs = get<utils::wpad::button_set>(p.buttons);
+
+            if (auto x = get_if<utils::wpad::pro::button_set>(&bs.ext)) {
+                // Note: the pro controller doesn't use the core buttons.
+                assign(notify::pad::wpad_pro, x->buttons, pat);
+                continue;
+            }
+
+            assign(notify::pad::wpad_core, bs.core.buttons, pat);
+
+            if (auto x = get_if<utils::wpad::nunchuk::button_set>(&bs.ext))
+                assign(notify::pad::wpad_nunchuk, x->buttons, pat);
+            else if (auto x = get_if<utils::wpad::classic::button_set>(&bs.ext))
+                assign(notify::pad::wpad_classic, x->buttons, pat);
+        }
+    }
+
+} // namespace pulse
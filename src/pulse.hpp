@@ -0,0 +1,36 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef PULSE_HPP
+#define PULSE_HPP
+
+#include <array>
+
+#include "notify.hpp"
+#include "turbo.hpp"
+
+
+/*
+ * The turbo patterns, compiled into one table per controller family.
+ *
+ * Every button gets its own copy of its pattern, so the turbo logic only needs the
+ * button's bit position to find it.
+ */
+
+namespace pulse {
+
+    // Indexed by notify::pad.
+    using table_set = std::array<turbo::pattern_set, 5>;
+
+
+    // Build the tables from cfg::patterns.
+    void compile(table_set& result);
+
+} // namespace pulse
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+#include <vpad/input.h>
+
+#include "remap.hpp"
+
+#include "cfg.hpp"
+
+
+using std::uint32_t;
+
+namespace utils = wups::utils;
+
+
+namespace remap {
+
+    bool
+    empty(const utils::button_combo& bc)
+        noexcept
+    {
+        if (auto bs = get_if<utils::vpad::button_set>(&bc))
+            return !bs->buttons;
+        const auto& bs = get<utils::wpad::button_set>(bc);
+        return !bs.core.buttons && bs.ext.index() == 0;
+    }
+
+
+    // The extension buttons of a set, or 0 if it's for another extension.
+    template<typename T>
+    uint32_t
+    ext_buttons(const utils::wpad::button_set& bs)
+        noexcept
+    {
+        if (auto x = get_if<T>(&bs.ext))
+            return x->buttons;
+        return 0;
+    }
+
+
+    void
+    build(table& t,
+          const std::array<uint32_t, 32>& targets)
+    {
+        t.touched = 0;
+        for (unsigned bit = 0; bit < 32; ++bit)
+            if (targets[bit] != uint32_t{1} << bit)
+                t.touched |= (uint32_t{1} << bit) | targets[bit];
+        t.active = t.touched;
+        t.left_stick  = 0;
+        t.right_stick = 0;
+
+        for (unsigned byte = 0; byte < 4; ++byte)
+            for (unsigned value = 0; value < 256; ++value) {
+                uint32_t result = 0;
+                for (unsigned bits = value; bits; bits &= bits - 1)
+                    result |= targets[8 * byte + std::countr_zero(bits)];
+                t.lut[byte][value] = result;
+            }
+    }
+
+
+    void
+    compile(table_set& result)
+    {
+        // What each button becomes, by family and bit position; the first remap listing a
+        // button wins.
+        std::array<std::array<uint32_t, 32>, 5> targets;
+        for (auto& t : targets)
+            for (unsigned bit = 0; bit < 32; ++bit)
+                t[bit] = uint32_t{1} << bit;
+        std::array<uint32_t, 5> assigned{};
+
+        auto assign = [&](notify::pad family,
+                          uint32_t from,
+                          uint32_t to)
+        {
+            const unsigned f = static_cast<unsigned>(family);
+            from &= ~assigned[f];
+            assigned[f] |= from;
+            for (; from; from &= from - 1)
+                targets[f][std::countr_zero(from)] = to;
+        };
+
+        for (const auto& r : cfg::remaps) {
+
+            if (empty(r.from))
+                continue;
+            // An empty "to" disables the buttons.
+            const bool disable = empty(r.to);
+
+            if (auto from = get_if<utils::vpad::button_set>(&r.from)) {
+                if (disable)
+                    assign(notify::pad::vpad, from->buttons, 0);
+                else if (auto to = get_if<utils::vpad::button_set>(&r.to))
+                    assign(notify::pad::vpad, from->buttons, to->buttons);
+                continue;
+            }
+
+            const auto& from = get<utils::wpad::button_set>(r.from);
+            const utils::wpad::button_set none;
+            const auto* to = disable ? &none : get_if<utils::wpad::button_set>(&r.to);
+            if (!to)
+                continue;
+            // Both sides must be for the same extension, or no extension.
+            if (from.ext.index() && to->ext.index() && from.ext.index() != to->ext.index())
+                continue;
+
+            using namespace utils::wpad;
+            switch (std::max(from.ext.index(), to->ext.index())) {
+
+            case 0:
+                // The core buttons also go into the nunchuk table, since they're stored
+                // together.
+                assign(notify::pad::wpad_core, from.core.buttons, to->core.buttons);
+                assign(notify::pad::wpad_nunchuk, from.core.buttons, to->core.buttons);
+                break;
+
+            case 1:
+                assign(notify::pad::wpad_nunchuk,
+                       from.core.buttons | ext_buttons<nunchuk::button_set>(from),
+                       to->core.buttons | ext_buttons<nunchuk::button_set>(*to));
+                break;
+
+            // Note: the classic and pro buttons are stored apart from the core buttons, so
+            // only the extension buttons can be remapped.
+
+            case 2:
+                assign(notify::pad::wpad_classic,
+                       ext_buttons<classic::button_set>(from),
+                       ext_buttons<classic::button_set>(*to));
+                break;
+
+            case 3:
+                assign(notify::pad::wpad_pro,
+                       ext_buttons<pro::button_set>(from),
+                       ext_buttons<pro::button_set>(*to));
+                break;
+
+            }
+        }
+
+        for (unsigned f = 0; f < result.size(); ++f)
+            build(result[f], targets[f]);
+
+        auto& t = result[static_cast<unsigned>(notify::pad::vpad)];
+        t.left_stick  = std::clamp(cfg::left_stick_dpad, 0, 100) / 100.0f;
+        t.right_stick = std::clamp(cfg::right_stick_dpad, 0, 100) / 100.0f;
+        if (t.left_stick > 0 || t.right_stick > 0) {
+            t.touched |= VPAD_BUTTON_LEFT | VPAD_BUTTON_RIGHT
+                       | VPAD_BUTTON_UP | VPAD_BUTTON_DOWN;
+            t.active = true;
+        }
+    }
+
+} // namespace remap
@@ -0,0 +1,62 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef REMAP_HPP
+#define REMAP_HPP
+
+#include <array>
+#include <cstdint>
+
+#include "notify.hpp"
+
+
+/*
+ * The button remaps, compiled into one table per controller family.
+ *
+ * Each table has what every byte of the button mask turns into, so remapping a sample costs
+ * four lookups, no matter how many buttons are remapped.
+ */
+
+namespace remap {
+
+    struct table {
+
+        // Indexed by each byte of the buttons, lowest first.
+        std::array<std::array<std::uint32_t, 256>, 4> lut;
+        std::uint32_t touched = 0; // buttons that are remapped, or that others become
+        bool          active  = false;
+
+        // Only for the VPAD: how far a stick must be pushed to press the D-pad, from 0 to
+        // 1; 0 is disabled.
+        float left_stick  = 0;
+        float right_stick = 0;
+
+
+        std::uint32_t
+        apply(std::uint32_t buttons)
+            const noexcept
+        {
+            return lut[0][buttons & 0xff]
+                 | lut[1][(buttons >> 8) & 0xff]
+                 | lut[2][(buttons >> 16) & 0xff]
+                 | lut[3][buttons >> 24];
+        }
+
+    };
+
+
+    // Indexed by notify::pad.
+    using table_set = std::array<table, 5>;
+
+
+    // Build the tables from cfg::remaps and the stick thresholds.
+    void compile(table_set& result);
+
+} // namespace remap
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef RING_HPP
+#define RING_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+
+/*
+ * Fixed-capacity, lock-free ring buffer: many producers, one consumer.
+ *
+ * Pushing never blocks and never allocates, so it's safe to use from the input hooks;
+ * when the ring is full, the new element is dropped.
+ */
+
+template<typename T,
+         unsigned N>
+class ring {
+
+    static_assert(N && !(N & (N - 1)), "capacity must be a power of 2");
+
+
+    struct slot {
+        std::atomic<std::uint32_t> seq;
+        T value;
+    };
+
+    std::array<slot, N> slots;
+
+    std::atomic<std::uint32_t> head = 0; // next position to push
+    std::uint32_t tail = 0;              // next position to pop, only used by the consumer
+
+    std::atomic<std::uint32_t> dropped_count = 0;
+
+public:
+
+    static constexpr unsigned capacity = N;
+
+
+    ring()
+        noexcept
+    {
+        for (unsigned i = 0; i < N; ++i)
+            slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+
+    // Can be called from any thread.
+    bool
+    push(const T& value)
+        noexcept
+    {
+        std::uint32_t pos = head.load(std::memory_order_relaxed);
+        for (;;) {
+            slot& s = slots[pos % N];
+            const std::uint32_t seq = s.seq.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::int32_t>(seq - pos);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) [[unlikely]] {
+                dropped_count.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else
+                pos = head.load(std::memory_order_relaxed);
+        }
+
+        slot& s = slots[pos % N];
+        s.value = value;
+        s.seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+
+    // Only the consumer thread can call this.
+    std::optional<T>
+    pop()
+        noexcept
+    {
+        slot& s = slots[tail % N];
+        if (s.seq.load(std::memory_order_acquire) != tail + 1)
+            return {};
+        T value = s.value;
+        s.seq.store(tail + N, std::memory_order_release);
+        ++tail;
+        return value;
+    }
+
+
+    // How many elements were dropped since the last call.
+    std::uint32_t
+    take_dropped()
+        noexcept
+    {
+        return dropped_count.exchange(0, std::memory_order_relaxed);
+    }
+
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+
+#include <coreinit/time.h>
+
+#include "snapshot.hpp"
+
+#include "cfg.hpp"
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+
+namespace snapshot {
+
+    namespace {
+
+        std::array<config, 2> buffers;
+
+        // Only one snapshot is built at a time.
+        std::mutex mutex;
+
+        std::atomic<bool> enabled_flag = false;
+        std::atomic<bool> vpad_flag    = false;
+        std::atomic<bool> wpad_flag    = false;
+
+        std::atomic<int> rate_override = -1;
+
+
+        void
+        build(config& conf)
+        {
+            conf.enabled = cfg::enabled;
+            conf.capture = cfg::capture;
+            conf.period  = cfg::period;
+            conf.rate    = effective_rate();
+            conf.sync    = static_cast<turbo::sync>(std::clamp(cfg::turbo_sync, 0, 2));
+            conf.budget  = static_cast<std::uint64_t>(std::max(cfg::time_budget, 0))
+                           * OSTimerClockSpeed / 1'000'000;
+            combo::compile(conf.combos);
+            pulse::compile(conf.patterns);
+            remap::compile(conf.remaps);
+        }
+
+
+        // A combo or a remap needs the hook, even with no turbo buttons.
+        bool
+        wants_hook(const config& conf,
+                   std::initializer_list<notify::pad> families)
+        {
+            for (auto family : families)
+                if (conf.get_combos(family).size || conf.get_remap(family).active)
+                    return true;
+            return false;
+        }
+
+    } // namespace
+
+
+    std::atomic<const config*> current = &buffers[0];
+
+
+    void
+    publish()
+    {
+        std::lock_guard guard{mutex};
+
+        // No hook is using the other snapshot since the last publish() returned.
+        const config* old = current.load(std::memory_order_relaxed);
+        config& next = old == &buffers[0] ? buffers[1] : buffers[0];
+        build(next);
+
+        current.store(&next, std::memory_order_seq_cst);
+
+        enabled_flag.store(next.enabled, std::memory_order_relaxed);
+        vpad_flag.store(wants_hook(next, {notify::pad::vpad}),
+                        std::memory_order_relaxed);
+        wpad_flag.store(wants_hook(next, {notify::pad::wpad_core,
+                                          notify::pad::wpad_nunchuk,
+                                          notify::pad::wpad_classic,
+                                          notify::pad::wpad_pro}),
+                        std::memory_order_relaxed);
+
+        vpad::synchronize();
+        wpad::synchronize();
+    }
+
+
+    void
+    set_rate_override(int rate)
+        noexcept
+    {
+        rate_override.store(rate, std::memory_order_relaxed);
+    }
+
+
+    int
+    effective_rate()
+        noexcept
+    {
+        const int rate = rate_override.load(std::memory_order_relaxed);
+        return rate >= 0 ? rate : cfg::rate;
+    }
+
+
+    bool
+    enabled()
+        noexcept
+    {
+        return enabled_flag.load(std::memory_order_relaxed);
+    }
+
+
+    bool
+    wants_vpad_hook()
+        noexcept
+    {
+        return vpad_flag.load(std::memory_order_relaxed);
+    }
+
+
+    bool
+    wants_wpad_hook()
+        noexcept
+    {
+        return wpad_flag.load(std::memory_order_relaxed);
+    }
+
+} // namespace snapshot
@@ -0,0 +1,113 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <atomic>
+#include <cstdint>
+
+#include "combo.hpp"
+#include "notify.hpp"
+#include "pulse.hpp"
+#include "remap.hpp"
+#include "turbo.hpp"
+
+
+/*
+ * What the input hooks need from the config, with all the tables already compiled.
+ *
+ * The menu edits the cfg variables in place, so the hooks never read them. Instead, a
+ * snapshot is built from them, and published through a single pointer. There are two
+ * snapshots: the hooks read the current one, while the other is rebuilt. After switching
+ * the pointer, publish() waits until every hook that might still be reading the old
+ * snapshot has returned, so it can be reused.
+ */
+
+namespace snapshot {
+
+    struct config {
+
+        bool          enabled = false;
+        bool          capture = false;
+        int           period  = 1;
+        int           rate    = 0;
+        turbo::sync   sync    = turbo::sync::none;
+        std::uint32_t budget  = 0; // ticks per sample; 0 = no limit
+
+        combo::table_set combos;
+        pulse::table_set patterns;
+        remap::table_set remaps;
+
+
+        const combo::table&
+        get_combos(notify::pad family)
+            const noexcept
+        {
+            return combos[static_cast<unsigned>(family)];
+        }
+
+
+        const turbo::pattern_set&
+        get_patterns(notify::pad family)
+            const noexcept
+        {
+            return patterns[static_cast<unsigned>(family)];
+        }
+
+
+        const remap::table&
+        get_remap(notify::pad family)
+            const noexcept
+        {
+            return remaps[static_cast<unsigned>(family)];
+        }
+
+    };
+
+
+    extern std::atomic<const config*> current;
+
+
+    /*
+     * Only the hooks can call this, after setting the busy flag of their channel with
+     * memory_order_seq_cst; the snapshot can only be used until the busy flag is cleared.
+     *
+     * Either publish() sees the busy flag set, and waits for it, or this sees the new
+     * pointer.
+     */
+    inline
+    const config&
+    get()
+        noexcept
+    {
+        return *current.load(std::memory_order_seq_cst);
+    }
+
+
+    // Build a new snapshot from the cfg variables, and switch the hooks to it. Blocks until
+    // the hooks stop using the old one.
+    void publish();
+
+
+    // The rate remembered for the running title, used instead of cfg::rate until the next
+    // title starts; negative for none. Takes effect on the next publish().
+    void set_rate_override(int rate) noexcept;
+
+    // The rate the hooks use: the override, or cfg::rate.
+    int effective_rate() noexcept;
+
+
+    // For the threads that install the hooks, which can't read the snapshot.
+    bool enabled() noexcept;
+    bool wants_vpad_hook() noexcept;
+    bool wants_wpad_hook() noexcept;
+
+} // namespace snapshot
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <cstdio>
+#include <span>
+
+#include <coreinit/time.h>
+
+#include "stats.hpp"
+
+#include "vpad.hpp"
+#include "wpad.hpp"
+
+
+namespace stats {
+
+    namespace {
+
+        // Upper limit of a bucket, in ticks.
+        double
+        upper_ticks(unsigned idx)
+        {
+            if (idx < 2)
+                return 2;
+            const unsigned e = idx / 2;
+            return (1u << e) + (idx % 2 + 1) * (1u << (e - 1));
+        }
+
+
+        std::string
+        format_us(double ticks)
+        {
+            char buf[32];
+            std::snprintf(buf, sizeof buf, "%.1f us",
+                          ticks * 1'000'000.0 / OSTimerClockSpeed);
+            return buf;
+        }
+
+
+        // Percentiles of the time spent in one hook, over all channels.
+        std::string
+        describe_time(std::span<const channel* const> channels)
+        {
+            std::array<std::uint64_t, num_buckets> hist{};
+            std::uint64_t total = 0;
+            for (const channel* ch : channels)
+                for (unsigned i = 0; i < num_buckets; ++i) {
+                    const auto n = ch->time[i].load(std::memory_order_relaxed);
+                    hist[i] += n;
+                    total += n;
+                }
+            if (!total)
+                return "not called";
+
+            auto percentile = [&](unsigned p) -> std::string
+            {
+                const std::uint64_t target = (total * p + 99) / 100;
+                std::uint64_t sum = 0;
+                for (unsigned i = 0; i < num_buckets; ++i) {
+                    sum += hist[i];
+                    if (sum >= target) {
+                        if (i == num_buckets - 1)
+                            return "> " + format_us(upper_ticks(i - 1));
+                        return "< " + format_us(upper_ticks(i));
+                    }
+                }
+                return "?";
+            };
+
+            return "p50 " + percentile(50) + ", p99 " + percentile(99);
+        }
+
+
+        void
+        describe_channels(std::vector<std::pair<std::string, std::string>>& result,
+                          const char* name,
+                          std::span<const channel* const> channels)
+        {
+            for (unsigned i = 0; i < channels.size(); ++i) {
+                const auto& ch = *channels[i];
+                const auto samples = ch.samples.load(std::memory_order_relaxed);
+                if (!samples)
+                    continue;
+                char label[32];
+                std::snprintf(label, sizeof label, "%s %u", name, i + 1);
+                auto get = [](const std::atomic<std::uint32_t>& counter) -> unsigned
+                {
+                    return counter.load(std::memory_order_relaxed);
+                };
+                char text[160];
+                const int len = std::snprintf(text, sizeof text,
+                                              "%u samples, %u presses, %u releases,"
+                                              " %u hidden",
+                                              get(ch.samples),
+                                              get(ch.presses),
+                                              get(ch.releases),
+                                              get(ch.hidden));
+                if (get(ch.degraded))
+                    std::snprintf(text + len, sizeof text - len,
+                                  ", %u times over budget, %u calls skipped",
+                                  get(ch.degraded),
+                                  get(ch.skipped));
+                result.emplace_back(label, text);
+            }
+        }
+
+    } // namespace
+
+
+    std::vector<std::pair<std::string, std::string>>
+    report()
+    {
+        std::array<const channel*, vpad::max_vpads> vpads;
+        for (unsigned i = 0; i < vpads.size(); ++i)
+            vpads[i] = &vpad::get_stats(i);
+        std::array<const channel*, wpad::max_wpads> wpads;
+        for (unsigned i = 0; i < wpads.size(); ++i)
+            wpads[i] = &wpad::get_stats(i);
+
+        std::vector<std::pair<std::string, std::string>> result;
+        result.emplace_back("VPAD hook time", describe_time(vpads));
+        result.emplace_back("WPAD hook time", describe_time(wpads));
+        describe_channels(result, "VPAD", vpads);
+        describe_channels(result, "WPAD", wpads);
+        return result;
+    }
+
+} // namespace stats
@@ -0,0 +1,110 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "turbo.hpp"
+
+
+/*
+ * Counters kept by the input hooks, shown in the config menu.
+ *
+ * Each channel has its own counters, owned by its hook and only written by it, so they're
+ * updated with plain loads and stores; the atomics only make them safe to read from the
+ * menu.
+ */
+
+namespace stats {
+
+    /*
+     * Time spent in the hook, as a histogram of ticks: two buckets per power of 2, so a
+     * percentile is known within 50%. The last bucket holds everything above 128 Ki ticks
+     * (about 2 ms).
+     */
+    inline constexpr unsigned num_buckets = 36;
+
+
+    constexpr
+    unsigned
+    bucket_of(std::uint32_t ticks)
+        noexcept
+    {
+        if (ticks < 2)
+            return 0;
+        const unsigned e = std::bit_width(ticks) - 1;
+        const unsigned idx = 2 * e + ((ticks >> (e - 1)) & 1);
+        return idx < num_buckets ? idx : num_buckets - 1;
+    }
+
+
+    struct channel {
+
+        std::array<std::atomic<std::uint32_t>, num_buckets> time{};
+        std::atomic<std::uint32_t> calls    = 0;
+        std::atomic<std::uint32_t> samples  = 0;
+        std::atomic<std::uint32_t> presses  = 0; // simulated presses
+        std::atomic<std::uint32_t> releases = 0; // simulated releases
+        std::atomic<std::uint32_t> hidden   = 0; // held buttons hidden from the game
+        std::atomic<std::uint32_t> degraded = 0; // times over the time budget
+        std::atomic<std::uint32_t> skipped  = 0; // calls left alone, see watchdog.hpp
+
+
+        // Only the hook of this channel can call these.
+
+        static
+        void
+        bump(std::atomic<std::uint32_t>& counter,
+             std::uint32_t n = 1)
+            noexcept
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + n,
+                          std::memory_order_relaxed);
+        }
+
+
+        void
+        add_call(std::uint32_t ticks,
+                 std::uint32_t num_samples)
+            noexcept
+        {
+            bump(time[bucket_of(ticks)]);
+            bump(calls);
+            bump(samples, num_samples);
+        }
+
+
+        void
+        add(const turbo::output& out)
+            noexcept
+        {
+            if (out.press) [[unlikely]]
+                bump(presses, std::popcount(out.press));
+            if (out.release) [[unlikely]]
+                bump(releases, std::popcount(out.release));
+            if (out.hide) [[unlikely]]
+                bump(hidden, std::popcount(out.hide));
+        }
+
+    };
+
+
+    // Labels and values for the config menu.
+    std::vector<std::pair<std::string, std::string>> report();
+
+} // namespace stats
+
+#endif
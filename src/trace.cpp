@@ -0,0 +1,113 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <coreinit/time.h>
+
+#include <wupsxx/logger.hpp>
+
+#include "trace.hpp"
+
+#include "ring.hpp"
+
+
+namespace logger = wups::logger;
+
+
+namespace trace {
+
+    ring<event, 64> events;
+
+
+    void
+    record(kind what,
+           notify::pad source,
+           unsigned channel,
+           std::uint32_t button)
+        noexcept
+    {
+        events.push({
+                .time    = OSGetTime(),
+                .button  = button,
+                .source  = source,
+                .channel = static_cast<std::uint8_t>(channel),
+                .what    = what
+            });
+    }
+
+
+    const char*
+    to_string(notify::pad source)
+    {
+        switch (source) {
+        case notify::pad::vpad:         return "vpad";
+        case notify::pad::wpad_core:    return "wpad";
+        case notify::pad::wpad_nunchuk: return "wpad nunchuk";
+        case notify::pad::wpad_classic: return "wpad classic";
+        case notify::pad::wpad_pro:     return "wpad pro";
+        }
+        return "?";
+    }
+
+
+    void
+    flush()
+    {
+        while (auto ev = events.pop()) {
+            const auto ms = static_cast<unsigned long long>(OSTicksToMilliseconds(ev->time));
+            const char* src = to_string(ev->source);
+            const unsigned chan = ev->channel;
+            switch (ev->what) {
+            case kind::toggling:
+                logger::printf("[%llu ms] %s %u: toggling turbo\n", ms, src, chan);
+                break;
+            case kind::canceled:
+                logger::printf("[%llu ms] %s %u: canceled turbo toggle\n", ms, src, chan);
+                break;
+            case kind::turbo:
+            case kind::normal:
+                logger::printf("[%llu ms] %s %u: button %s = %s\n",
+                               ms, src, chan,
+                               notify::to_string(ev->source, ev->button).c_str(),
+                               ev->what == kind::turbo ? "turbo" : "normal");
+                break;
+            case kind::recording:
+                logger::printf("[%llu ms] %s %u: recording macro\n", ms, src, chan);
+                break;
+            case kind::recorded:
+                logger::printf("[%llu ms] %s %u: recorded macro, %u samples\n",
+                               ms, src, chan, unsigned{ev->button});
+                break;
+            case kind::playing:
+                logger::printf("[%llu ms] %s %u: playing macro\n", ms, src, chan);
+                break;
+            case kind::played:
+                logger::printf("[%llu ms] %s %u: stopped macro\n", ms, src, chan);
+                break;
+            case kind::no_macro:
+                logger::printf("[%llu ms] %s %u: no macro to play\n", ms, src, chan);
+                break;
+            case kind::degraded:
+                {
+                    const auto us = OSTicksToMicroseconds(ev->button);
+                    logger::printf("[%llu ms] %s %u: took %llu us, over the time budget;"
+                                   " leaving the input alone\n",
+                                   ms, src, chan, static_cast<unsigned long long>(us));
+                }
+                break;
+            case kind::restored:
+                logger::printf("[%llu ms] %s %u: within the time budget again\n",
+                               ms, src, chan);
+                break;
+            }
+        }
+
+        if (auto dropped = events.take_dropped())
+            logger::printf("Dropped %u trace events.\n", unsigned{dropped});
+    }
+
+} // namespace trace
@@ -0,0 +1,59 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstdint>
+
+#include "notify.hpp"
+
+
+// Binary event log for the input hooks; it's written to the logger later, by flush().
+
+namespace trace {
+
+    enum class kind : std::uint8_t {
+        toggling,       // toggle combo activated
+        canceled,       // toggle combo canceled
+        turbo,          // button set to turbo
+        normal,         // button set to normal
+        recording,      // macro recording started
+        recorded,       // macro recording stopped
+        playing,        // macro playback started
+        played,         // macro playback stopped
+        no_macro,       // nothing to play
+        degraded,       // over the time budget, input left alone
+        restored,       // within the time budget again
+    };
+
+
+    struct event {
+        std::int64_t  time;    // OSGetTime()
+        std::uint32_t button;  // native button bit for turbo/normal, samples for recorded,
+                               // ticks for degraded
+        notify::pad   source;
+        std::uint8_t  channel;
+        kind          what;
+    };
+
+
+    // Only a few stores, doesn't block, doesn't allocate.
+    void record(kind what,
+                notify::pad source,
+                unsigned channel,
+                std::uint32_t button = 0) noexcept;
+
+
+    // Write all recorded events to the logger. Only the worker thread calls this, since the
+    // ring has a single consumer.
+    void flush();
+
+} // namespace trace
+
+#endif
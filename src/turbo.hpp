@@ -0,0 +1,455 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef TURBO_HPP
+#define TURBO_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+#include <coreinit/time.h>
+
+
+/*
+ * The turbo logic, shared by all controller types.
+ *
+ * All buttons are processed at once, as masks of the native button bits; only the
+ * turbinated buttons being held down need to be visited one by one, to advance their
+ * pattern.
+ *
+ * Optionally, all turbinated buttons follow one shared step count (the beat) instead of
+ * their own, so they stay in phase with each other.
+ */
+
+namespace turbo {
+
+    // What happened to the buttons in one sample.
+    struct output {
+        std::uint32_t hide    = 0; // buttons to hide from the game
+        std::uint32_t press   = 0; // simulated press events
+        std::uint32_t release = 0; // simulated release events
+        std::uint32_t toggled = 0; // button that had its turbo toggled (at most one)
+    };
+
+
+    // Buttons held in one sample, and what changed since the previous sample.
+    struct edges {
+        std::uint32_t hold    = 0;
+        std::uint32_t trigger = 0;
+        std::uint32_t release = 0;
+    };
+
+
+    // Derive the edges from the buttons held in the previous sample, and remember the
+    // buttons held now.
+    template<typename T>
+    edges
+    track(T& prev,
+          std::uint32_t hold)
+        noexcept
+    {
+        const std::uint32_t changed = hold ^ prev;
+        prev = hold;
+        return {hold, changed & hold, changed & ~hold};
+    }
+
+
+    // Who shares the turbo phase.
+    enum class sync : std::uint8_t {
+        none,    // every button has its own phase, starting when it's pressed
+        channel, // all buttons of a controller share one beat
+        global,  // all buttons of all controllers share one beat
+    };
+
+
+    // How the turbo phase advances in one sample.
+    struct phase {
+        int           period; // if not zero, a step takes this many samples held
+        std::uint32_t steps;  // otherwise, how many steps (half a cycle) passed
+        bool          synced = false;
+        std::uint32_t beat   = 0; // when synced, the step every button is at
+    };
+
+
+    // The global beat only depends on the time, so every controller gets the same one. With
+    // no rate, a step takes "period" frames of 60 Hz.
+    inline
+    std::uint32_t
+    global_beat(int period,
+                int rate)
+        noexcept
+    {
+        const OSTime frame = OSTimerClockSpeed / 60;
+        const OSTime step = rate > 0
+                          ? OSTimerClockSpeed / (2 * rate)
+                          : frame * std::max(period, 1);
+        return OSGetTime() / step;
+    }
+
+
+    /*
+     * The shape of the turbo presses, as a table of steps: bit i tells if the button is
+     * pressed at step i. The default is the plain turbo: released for one step, pressed
+     * for the next.
+     *
+     * With a lead of 0, the pattern is anchored to the press: the sample where the button
+     * is pressed shows step 0. Otherwise that sample already counts towards the first step.
+     */
+    struct pattern {
+        std::uint64_t bits   = 0b10;
+        std::uint8_t  length = 2;     // at most 63 steps
+        bool          loop   = true;  // otherwise, stay released after the last step
+        std::uint8_t  lead   = 1;
+
+
+        std::uint8_t
+        advance(unsigned step,
+                unsigned count)
+            const noexcept
+        {
+            step += count;
+            if (step >= length) [[unlikely]]
+                step = loop ? step % length : length;
+            return step;
+        }
+
+
+        bool
+        pressed(unsigned step)
+            const noexcept
+        {
+            return (bits >> step) & 1;
+        }
+    };
+
+
+    // The pattern for each button, indexed by bit position.
+    using pattern_set = std::array<pattern, 32>;
+
+
+    // Time-based turbo for one channel: counts how many steps passed since the last sample,
+    // so the rate doesn't depend on how often the game reads the input.
+    struct clock {
+
+        // Note: 32-bit ticks wrap around, so they're only compared through differences.
+        std::uint32_t next_step = 0;
+        std::uint32_t beat      = 0; // for sync::channel
+        std::uint8_t  age       = 0; // samples since the beat advanced, with a period
+
+
+        phase
+        tick(int period,
+             int rate)
+            noexcept
+        {
+            if (rate <= 0) [[likely]]
+                return {period, 1};
+
+            const std::uint32_t now = OSGetSystemTick();
+            const std::int32_t step = OSTimerClockSpeed / (2 * rate);
+            const auto late = static_cast<std::int32_t>(now - next_step);
+
+            if (late < -step || late > OSTimerClockSpeed) [[unlikely]] {
+                // First sample, or no samples for a while: start over.
+                next_step = now + step;
+                return {0, 0};
+            }
+
+            // Samples read again within the same step don't advance the phase.
+            if (late < 0)
+                return {0, 0};
+
+            const std::uint32_t steps = 1 + late / step;
+            next_step += steps * step;
+            return {0, steps};
+        }
+
+
+        // Called once per sample, even with no buttons held, so the beat keeps going.
+        phase
+        tick(int period,
+             int rate,
+             sync mode)
+            noexcept
+        {
+            phase ph = tick(period, rate);
+            switch (mode) {
+            case sync::none:
+                break;
+            case sync::channel:
+                if (!ph.period)
+                    beat += ph.steps;
+                else if (++age >= ph.period) {
+                    age = 0;
+                    ++beat;
+                }
+                ph.synced = true;
+                ph.beat = beat;
+                break;
+            case sync::global:
+                ph.synced = true;
+                ph.beat = global_beat(period, rate);
+                break;
+            }
+            return ph;
+        }
+
+    };
+
+
+    template<const auto& button_list>
+    struct kernel {
+
+        using button_type = std::remove_cvref_t<decltype(button_list[0])>;
+
+
+        static constexpr
+        std::uint32_t mask = []
+        {
+            std::uint32_t result = 0;
+            for (auto btn : button_list)
+                result |= btn;
+            return result;
+        }();
+
+
+        // Lowest button bit; ages are not stored for the bits below it.
+        static constexpr
+        unsigned first_bit = std::countr_zero(mask);
+
+
+        // Smallest type that holds all the button bits.
+        using mask_type = std::conditional_t<std::bit_width(mask) <= 16,
+                                             std::uint16_t,
+                                             std::uint32_t>;
+
+
+        struct state {
+            mask_type turbo     = 0;
+            mask_type fake_hold = 0;
+            mask_type suppress  = 0;
+            mask_type active    = 0; // turbo buttons held in the last sample
+            mask_type anchored  = 0; // pressed with a lead of 0, first count not skipped yet
+            // Indexed by bit position (from first_bit), not by position in button_list.
+            std::array<std::uint8_t, std::bit_width(mask) - first_bit> age{};
+            std::array<std::uint8_t, std::bit_width(mask) - first_bit> step{};
+
+
+            // Forget everything but the turbo buttons.
+            void
+            clear_transient()
+                noexcept
+            {
+                *this = state{ .turbo = turbo };
+            }
+        };
+
+
+        // When many buttons are triggered at once, button_list order decides which one
+        // gets toggled.
+        static
+        std::uint32_t
+        first_of(std::uint32_t buttons)
+            noexcept
+        {
+            for (auto btn : button_list)
+                if (buttons & btn)
+                    return btn;
+            return 0;
+        }
+
+
+        // Advance a button by some steps, and update its bit in the fake state.
+        static
+        std::uint32_t
+        enter(state& st,
+              std::uint32_t fake,
+              unsigned idx,
+              const pattern& pat,
+              unsigned steps)
+            noexcept
+        {
+            auto& step = st.step[idx - first_bit];
+            step = pat.advance(step, steps);
+            const std::uint32_t bit = std::uint32_t{1} << idx;
+            return (fake & ~bit) | (pat.pressed(step) ? bit : 0);
+        }
+
+
+        // Turbinated buttons being held down follow their pattern, from the start on every
+        // press; only the buttons that reach a new step need to look it up. Takes the fake
+        // state of the buttons that were already held.
+        static
+        std::uint32_t
+        advance(state& st,
+                std::uint32_t fake,
+                std::uint32_t active,
+                std::uint32_t pressed,
+                phase ph,
+                const pattern_set& patterns)
+            noexcept
+        {
+            st.anchored &= ~pressed;
+            for (std::uint32_t a = pressed; a; a &= a - 1) {
+                const unsigned idx = std::countr_zero(a);
+                const pattern& pat = patterns[idx];
+                // Note: with a lead, the loops below count this sample towards the first
+                // step.
+                if (pat.lead)
+                    st.age[idx - first_bit] = pat.lead - 1;
+                else {
+                    st.age[idx - first_bit] = 0;
+                    st.anchored |= std::uint32_t{1} << idx;
+                }
+                st.step[idx - first_bit] = 0;
+                fake |= std::uint32_t{pat.pressed(0)} << idx;
+            }
+            // An anchored press skips its first count, so its first step is never cut short:
+            // with a period, that's the sample it's pressed in; with a rate, the first step
+            // boundary, which may take many samples.
+            if (ph.period) [[likely]] {
+                for (std::uint32_t a = active & ~st.anchored; a; a &= a - 1) {
+                    const unsigned idx = std::countr_zero(a);
+                    auto& age = st.age[idx - first_bit];
+                    if (++age >= ph.period) {
+                        age = 0;
+                        fake = enter(st, fake, idx, patterns[idx], 1);
+                    }
+                }
+                st.anchored = 0;
+            } else if (ph.steps) {
+                for (std::uint32_t a = active; a; a &= a - 1) {
+                    const unsigned idx = std::countr_zero(a);
+                    unsigned steps = ph.steps;
+                    if (st.anchored & (std::uint32_t{1} << idx)) [[unlikely]]
+                        if (!--steps)
+                            continue;
+                    fake = enter(st, fake, idx, patterns[idx], steps);
+                }
+                st.anchored = 0;
+            }
+            return fake;
+        }
+
+
+        // With a shared beat, every button is at the same step, so no state is kept per
+        // button. The patterns always loop, and their lead doesn't apply.
+        static
+        std::uint32_t
+        at_beat(std::uint32_t active,
+                std::uint32_t beat,
+                const pattern_set& patterns)
+            noexcept
+        {
+            std::uint32_t fake = 0;
+            for (std::uint32_t a = active; a; a &= a - 1) {
+                const unsigned idx = std::countr_zero(a);
+                const pattern& pat = patterns[idx];
+                fake |= std::uint32_t{pat.pressed(beat % pat.length)} << idx;
+            }
+            return fake;
+        }
+
+
+        static
+        output
+        run(state& st,
+            bool& toggling,
+            std::uint32_t hold,
+            std::uint32_t trigger,
+            std::uint32_t release,
+            phase ph,
+            const pattern_set& patterns)
+            noexcept
+        {
+            output out;
+
+            hold    &= mask;
+            trigger &= mask;
+            release &= mask;
+
+            // Suppressed buttons are kept clear, until they're no longer held, or released.
+            out.hide = st.suppress;
+            st.suppress &= hold & ~release;
+
+            std::uint32_t live = mask & ~out.hide;
+
+            if (toggling && (trigger & live)) [[unlikely]] {
+                // A button was triggered in the toggling state: toggle it, hide it, and
+                // suppress it until it's released.
+                const std::uint32_t btn = first_of(trigger & live);
+                toggling = false;
+                st.turbo     ^= btn;
+                st.fake_hold &= ~btn;
+                st.suppress  |= btn;
+                st.age[std::countr_zero(btn) - first_bit] = 0;
+                st.anchored  &= ~btn;
+                out.toggled = btn;
+                out.hide |= btn;
+                live &= ~btn;
+            }
+
+            const std::uint32_t active = st.turbo & hold & live;
+            const std::uint32_t pressed = active & ~st.active;
+            st.active = active;
+            std::uint32_t fake;
+            if (ph.synced) [[unlikely]]
+                fake = at_beat(active, ph.beat, patterns);
+            else
+                fake = advance(st, st.fake_hold & active & ~pressed, active, pressed, ph,
+                               patterns);
+            // The game saw the newly pressed buttons as released.
+            const std::uint32_t flip = (fake ^ (st.fake_hold & ~pressed)) & active;
+
+            // Everything else just copies the real button state.
+            fake |= hold & live & ~active;
+            st.fake_hold = (st.fake_hold & ~live) | fake;
+
+            out.press   = flip & fake;
+            out.release = flip & ~fake;
+            // Between flips, turbinated buttons keep showing the fake state.
+            out.hide |= active & ~fake & ~flip;
+
+            return out;
+        }
+
+    };
+
+
+    // Apply the output to a status with separate hold/trigger/release fields.
+    inline
+    void
+    apply(const output& out,
+          std::uint32_t& hold,
+          std::uint32_t& trigger,
+          std::uint32_t& release)
+        noexcept
+    {
+        const std::uint32_t clear = out.hide | out.release;
+        hold    &= ~clear;
+        trigger  = (trigger & ~clear) | out.press;
+        release  = (release & ~(out.hide | out.press)) | out.release;
+    }
+
+
+    // Apply the output to a status with only a hold field.
+    template<typename T>
+    void
+    apply(const output& out,
+          T& buttons)
+        noexcept
+    {
+        buttons = (buttons & ~(out.hide | out.release)) | out.press;
+    }
+
+} // namespace turbo
+
+#endif
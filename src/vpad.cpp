@@ -6,178 +6,173 @@
  * SPDX-License-Identifier: GPL-3.0-or-later
  */
 
+#include <algorithm>
 #include <array>
-#include <bitset>
+#include <atomic>
 #include <cstdint>
-#include <cstdio>
-#include <ranges>
 
+#include <coreinit/time.h>
 #include <vpad/input.h>
 
-#include <wups/function_patching.h>
-
-#include <wupsxx/button_combo.hpp>
-#include <wupsxx/logger.hpp>
-
 #include "vpad.hpp"
+#include "vpad_shared.hpp"
 
-#include "cfg.hpp"
+#include "capture.hpp"
+#include "combo.hpp"
+#include "hooks.hpp"
+#include "macro.hpp"
 #include "notify.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "turbo.hpp"
+#include "watchdog.hpp"
 
 
 using std::array;
 using std::int32_t;
 using std::uint32_t;
-using std::uint8_t;
-using std::views::enumerate;
-
-using wups::utils::button_combo;
-
-namespace logger = wups::logger;
 
 
 namespace vpad {
 
-    constexpr unsigned max_vpads = 2;
-
-
-    constexpr array button_list = {
-        VPAD_BUTTON_A,
-        VPAD_BUTTON_B,
-        VPAD_BUTTON_X,
-        VPAD_BUTTON_Y,
-        VPAD_BUTTON_LEFT,
-        VPAD_BUTTON_RIGHT,
-        VPAD_BUTTON_UP,
-        VPAD_BUTTON_DOWN,
-        VPAD_BUTTON_L,
-        VPAD_BUTTON_ZL,
-        VPAD_BUTTON_R,
-        VPAD_BUTTON_ZR,
-        VPAD_BUTTON_PLUS,
-        VPAD_BUTTON_MINUS,
+    // 5 x 2 bytes masks + 14 ages + 14 steps + 3 flags + real hold + clock = 60 bytes;
+    // aligned so each channel owns two whole cache lines.
+    struct alignas(32) pad_state_t : kernel::state {
+        bool          toggling    = false;
+        std::uint8_t  reset_seen  = 0; // last request applied, see apply_requests()
+        std::uint8_t  resume_seen = 0;
+        std::uint32_t real_hold   = 0; // buttons held in the last sample seen
+        turbo::clock  clock;
     };
 
-    constexpr unsigned max_buttons = button_list.size();
+    static_assert(sizeof(pad_state_t) == 64);
 
-    using button_set = std::bitset<max_buttons>;
-
-    struct pad_state_t {
-        button_set turbo;
-        button_set fake_hold;
-        button_set suppress;
-        array<uint8_t, max_buttons> age{};
-        bool       toggling = false;
-    };
 
+    // Only the hook touches these.
     array<pad_state_t, max_vpads> state;
+    array<macro::tape, max_vpads> tapes;
+    array<stats::channel, max_vpads> counters;
+    array<watchdog::state, max_vpads> watchdogs;
 
 
-    // reset all variables
     void
-    reset()
+    publish(const pad_state_t& pad,
+            VPADChan channel)
+        noexcept
     {
-        logger::printf("Resetting vpads\n");
-        state.fill({});
+        channels[channel].summary.store({pad.turbo, pad.toggling});
     }
 
 
+    // The samples since the last one seen are unknown, forget all but the turbos.
     void
-    toggle_button(pad_state_t& pad,
-                  unsigned idx,
-                  VPADChan channel)
+    resume(pad_state_t& pad,
+           VPADChan channel)
+        noexcept
     {
-        pad.toggling = false;
-        pad.turbo.flip(idx);
-
-        auto btn = button_list[idx];
-
-        wups::utils::vpad::button_set bs{btn};
-
-        const char* on_off = pad.turbo.test(idx) ? "turbo" : "normal";
-        notify::info("%s = %s",
-                     to_glyph(bs).c_str(),
-                     on_off);
-
-        logger::printf("vpad %u button %s [%u] = %s\n",
-                       unsigned{channel},
-                       to_string(bs).c_str(),
-                       idx,
-                       on_off);
+        pad.clear_transient();
+        pad.toggling  = false;
+        pad.real_hold = 0;
+        tapes[channel].stop();
     }
 
 
+    // Apply the requests posted by other threads.
     void
-    run_turbo_logic(pad_state_t& pad,
-                    VPADStatus& status,
-                    VPADChan channel)
+    apply_requests(pad_state_t& pad,
+                   VPADChan channel)
+        noexcept
     {
-        for (auto [idx, btn] : enumerate(button_list)) {
-
-            const auto not_btn = ~uint32_t{btn};
-
-            // If this is a suppressed button, don't process it, keep it clear and
-            // skip further turbo processing.
-            if (pad.suppress.test(idx)) {
-                // if the button is not held, or was released, we stop suppressing it
-                if (!(status.hold & btn) || (status.release & btn))
-                    pad.suppress.reset(idx);
+        bool changed = false;
+
+        if (reset_request.take(pad.reset_seen)) [[unlikely]] {
+            pad.clear_transient();
+            pad.turbo    = 0;
+            pad.toggling = false;
+            pad.clock    = {};
+            tapes[channel] = {};
+            watchdogs[channel] = {};
+            changed = true;
+        }
 
-                status.hold    &= not_btn;
-                status.trigger &= not_btn;
-                status.release &= not_btn;
+        if (resume_request.take(pad.resume_seen)) [[unlikely]] {
+            resume(pad, channel);
+            changed = true;
+        }
 
-                continue;
+        auto& chan = channels[channel];
+        if (chan.load_pending.load(std::memory_order_relaxed)) [[unlikely]]
+            if (chan.load_pending.exchange(false, std::memory_order_acquire)) {
+                pad.clear_transient();
+                pad.turbo = chan.loaded_turbo.load(std::memory_order_relaxed);
+                tapes[channel].stop();
+                changed = true;
             }
 
-            if (pad.toggling && (status.trigger & btn)) {
-
-                // We're in the toggling state, and a button was triggered.
-                toggle_button(pad, idx, channel);
-
-                // Hide this event from the game.
-                status.hold    &= not_btn;
-                status.trigger &= not_btn;
-                status.release &= not_btn;
-
-                pad.fake_hold.reset(idx);
-
-                // This button will be suppressed until a release event happens.
-                pad.suppress.set(idx);
-
-                pad.age[idx] = 0;
-
-            } else {
-
-                // We're not in the toggling state, just check if it's a turbinated button
-                // held down.
-
-                bool turbinated = pad.turbo.test(idx);
-                if (turbinated && (status.hold & btn)) {
+        if (changed)
+            publish(pad, channel);
+    }
 
-                    if (++pad.age[idx] >= cfg::period) {
 
-                        pad.fake_hold.flip(idx);
-                        pad.age[idx] = 0;
+    void
+    toggle_button(pad_state_t& pad,
+                  std::uint32_t btn,
+                  VPADChan channel)
+        noexcept
+    {
+        const bool on = pad.turbo & btn;
+        notify::post({
+                .source  = notify::pad::vpad,
+                .kind    = on ? notify::what::turbo : notify::what::normal,
+                .channel = static_cast<std::uint8_t>(channel),
+                .button  = btn
+            });
+        trace::record(on ? trace::kind::turbo : trace::kind::normal,
+                      notify::pad::vpad, channel, btn);
+    }
 
-                        if (pad.fake_hold.test(idx)) {
-                            // simulate a press event
-                            status.trigger |= btn;
-                            status.release &= not_btn;
-                        } else {
-                            // simulate a release event
-                            status.hold    &= not_btn;
-                            status.trigger &= not_btn;
-                            status.release |= btn;
-                        }
 
-                    }
+    // The D-pad buttons pressed by a stick pushed past the threshold.
+    uint32_t
+    stick_to_dpad(const VPADVec2D& stick,
+                  float threshold)
+        noexcept
+    {
+        if (threshold <= 0)
+            return 0;
+        uint32_t result = 0;
+        if (stick.x >= threshold)
+            result |= VPAD_BUTTON_RIGHT;
+        else if (stick.x <= -threshold)
+            result |= VPAD_BUTTON_LEFT;
+        if (stick.y >= threshold)
+            result |= VPAD_BUTTON_UP;
+        else if (stick.y <= -threshold)
+            result |= VPAD_BUTTON_DOWN;
+        return result;
+    }
 
-                } else // if no turbo action, just copy the real button state
-                    pad.fake_hold.set(idx, status.hold & btn);
 
-            }
+    void
+    run_turbo_logic(pad_state_t& pad,
+                    VPADStatus& status,
+                    VPADChan channel,
+                    const snapshot::config& conf)
+        noexcept
+    {
+        auto out = kernel::run(pad, pad.toggling,
+                               status.hold, status.trigger, status.release,
+                               pad.clock.tick(conf.period, conf.rate, conf.sync),
+                               conf.get_patterns(notify::pad::vpad));
+        counters[channel].add(out);
+
+        if (out.toggled) [[unlikely]] {
+            toggle_button(pad, out.toggled, channel);
+            publish(pad, channel);
         }
+
+        turbo::apply(out, status.hold, status.trigger, status.release);
     }
 
 
@@ -187,79 +182,192 @@ namespace vpad {
                   VPADStatus* buf,
                   uint32_t count,
                   VPADReadError* error)
+        noexcept
     {
         int32_t result = real_VPADRead(channel, buf, count, error);
         if (error && *error) [[unlikely]]
             return result;
-        if (!cfg::enabled)
-            return result;
         if (!buf) [[unlikely]]
             return result;
+        if (static_cast<unsigned>(channel) >= max_vpads) [[unlikely]]
+            return result;
 
-        auto& pad = state[channel];
-
-        bool is_loose = !VPADGetButtonProcMode(channel);
-        int32_t real_count = is_loose ? 1 : result;
-        for (int32_t idx = real_count - 1; idx >= 0; --idx) {
-            VPADStatus& status = buf[idx];
-            if (wups::utils::vpad::update(channel, status)) {
-
-                bool combo_activated = false;
-                for (const auto& combo : cfg::toggle_combo)
-                    if (wups::utils::vpad::triggered(channel, combo)) {
-                        combo_activated = true;
-                        break;
-                    }
+        if (!hook_active.load(std::memory_order_relaxed))
+            return result;
 
-                // Note: when a combo is activated, don't do any turbo processing.
-                if (combo_activated) [[unlikely]] {
+        // If another thread is reading this channel right now, leave these samples alone.
+        auto& busy = channels[channel].busy;
+        // Note: seq_cst, so the config snapshot can be read; see snapshot::get().
+        if (busy.test_and_set(std::memory_order_seq_cst)) [[unlikely]]
+            return result;
 
-                    // Enter or leave toggling state.
-                    pad.toggling = !pad.toggling;
+        // Note: seq_cst, so remove_hook() either sees busy set, or this sees it inactive.
+        const auto& conf = snapshot::get();
+        if (!hook_active.load(std::memory_order_seq_cst) || !conf.enabled) [[unlikely]] {
+            busy.clear(std::memory_order_release);
+            return result;
+        }
 
-                    notify::info(pad.toggling
-                                 ? "Toggling turbo..."
-                                 : "Canceled turbo toggle.");
+        auto& ran = channels[channel].ran;
+        if (!ran.load(std::memory_order_relaxed)) [[unlikely]]
+            ran.store(true, std::memory_order_relaxed);
 
-                    // Keep all held buttons suppressed.
-                    for (auto [btn_idx, btn] : enumerate(button_list))
-                        if (status.hold & btn)
-                            pad.suppress.set(btn_idx);
+        // Note: the time is measured from here, so real_VPADRead() is not included.
+        const uint32_t start = OSGetSystemTick();
 
-                    // Discard all buttons.
+        auto& pad = state[channel];
+        apply_requests(pad, channel);
+
+        auto& dog = watchdogs[channel];
+        switch (dog.admit(start)) {
+        case watchdog::verdict::run:
+            break;
+        case watchdog::verdict::skip:
+            stats::channel::bump(counters[channel].skipped);
+            busy.clear(std::memory_order_release);
+            return result;
+        case watchdog::verdict::resume:
+            resume(pad, channel);
+            publish(pad, channel);
+            break;
+        }
 
-                    // Note: buttons that were triggered right now are not released, since
-                    // their trigger event will never be recorded. We only release the
-                    // buttons that were being held before the trigger.
-                    status.release = status.hold ^ status.trigger;
-                    status.hold = 0;
-                    status.trigger = 0;
+        // In loose mode, the trigger and release fields are not per sample, but everything
+        // since the last read; so the edges of the buttons Turbiine changes (turbo,
+        // suppressed, remapped, or played by a macro) are recomputed here, for every
+        // sample, and accumulated again after the turbo logic. The other buttons keep the
+        // edges from the hardware, which also has the presses shorter than a sample.
+        const bool is_loose = !VPADGetButtonProcMode(channel);
+        uint32_t loose_trigger = 0;
+        uint32_t loose_release = 0;
+
+        const bool capturing = conf.capture;
+
+        const auto& map = conf.get_remap(notify::pad::vpad);
+        auto& tape = tapes[channel];
+        // Note: it only grows during the call, so a button is never left with a mix of
+        // hardware and recomputed edges.
+        uint32_t edge_mask = map.touched;
+
+        // Samples are processed in order, oldest first; buf[0] is the most recent one.
+        for (int32_t idx = result - 1; idx >= 0; --idx) {
+            VPADStatus& status = buf[idx];
+            const uint32_t raw_hold = status.hold;
+
+            // Note: a button toggled or suppressed in this sample is hidden by the turbo
+            // logic, so its hardware edges are cleared anyway.
+            edge_mask |= pad.turbo | pad.suppress;
+            if (tape.state == macro::tape::mode::playing) [[unlikely]]
+                edge_mask |= kernel::mask;
+
+            // Note: everything after this sees the remapped buttons, like the game does.
+            if (map.active) [[unlikely]]
+                status.hold = map.apply(status.hold)
+                            | stick_to_dpad(status.leftStick, map.left_stick)
+                            | stick_to_dpad(status.rightStick, map.right_stick);
+
+            const auto e = turbo::track(pad.real_hold, status.hold);
+            status.trigger = (status.trigger & ~edge_mask) | (e.trigger & edge_mask);
+            status.release = (status.release & ~edge_mask) | (e.release & edge_mask);
+
+            // Note: when a combo is activated, don't do any turbo processing.
+            const auto action = conf.get_combos(notify::pad::vpad).triggered(e.hold,
+                                                                             e.trigger);
+            if (action != combo::action::none) [[unlikely]] {
+
+                if (action == combo::action::toggle) {
+                    // Enter or leave toggling state.
+                    pad.toggling = !pad.toggling;
 
-                } else [[likely]]
-                    try {
-                        run_turbo_logic(pad, status, channel);
-                    }
-                    catch (std::exception& e) {
-                        logger::printf("Error running VPAD turbo logic: %s\n", e.what());
+                    notify::post({
+                            .source  = notify::pad::vpad,
+                            .kind    = pad.toggling
+                                       ? notify::what::toggling
+                                       : notify::what::canceled,
+                            .channel = static_cast<std::uint8_t>(channel),
+                            .button  = 0
+                        });
+                    trace::record(pad.toggling
+                                  ? trace::kind::toggling
+                                  : trace::kind::canceled,
+                                  notify::pad::vpad, channel);
+                    publish(pad, channel);
+                } else
+                    macro::on_combo(tape, action, notify::pad::vpad, channel);
+
+                // Keep all held buttons suppressed.
+                pad.suppress |= status.hold & kernel::mask;
+
+                // Discard all buttons.
+
+                // Note: buttons that were triggered right now are not released, since
+                // their trigger event will never be recorded. We only release the
+                // buttons that were being held before the trigger.
+                status.release = status.hold ^ status.trigger;
+                status.hold = 0;
+                status.trigger = 0;
+
+            } else [[likely]] {
+                bool played_out = false;
+                if (!tape.idle()) [[unlikely]] {
+                    if (tape.state == macro::tape::mode::recording)
+                        macro::record(tape, {e.hold & kernel::mask},
+                                      notify::pad::vpad, channel);
+                    else {
+                        // The macro replaces the real buttons, so the turbo logic and
+                        // the loose mode see it like a real press.
+                        turbo::edges m, unused;
+                        const auto s = macro::play(tape, m, unused,
+                                                   notify::pad::vpad, channel);
+                        status.hold    = (status.hold    & ~kernel::mask) | s.core;
+                        status.trigger = (status.trigger & ~kernel::mask) | m.trigger;
+                        status.release = (status.release & ~kernel::mask) | m.release;
+                        played_out = tape.idle();
                     }
+                }
+                run_turbo_logic(pad, status, channel, conf);
+                // The real buttons are back on the next sample; the ones held now were
+                // never seen pressed, so they're suppressed until released.
+                if (played_out) [[unlikely]]
+                    pad.suppress |= e.hold & kernel::mask;
+            }
 
+            if (is_loose) {
+                loose_trigger |= status.trigger & edge_mask;
+                loose_release |= status.release & edge_mask;
+                status.trigger = (status.trigger & ~edge_mask) | loose_trigger;
+                status.release = (status.release & ~edge_mask) | loose_release;
             }
 
+            if (capturing) [[unlikely]]
+                capture::push(notify::pad::vpad, channel,
+                              {start, raw_hold, 0, status.hold, 0, notify::pad::vpad,
+                               idx == result - 1, is_loose});
+
         }
 
-        if (is_loose) {
-            // Every sample in buf should have the same button state.
-            for (int32_t idx = 1; idx < result; ++idx) {
-                buf[idx].hold = buf[0].hold;
-                buf[idx].trigger = buf[0].trigger;
-                buf[idx].release = buf[0].release;
-            }
+        const uint32_t num_samples = result > 0 ? result : 0;
+        const uint32_t now = OSGetSystemTick();
+        const uint32_t elapsed = now - start;
+        counters[channel].add_call(elapsed, num_samples);
+        // The budget is per sample, since a call can read up to 16 samples.
+        switch (dog.check(elapsed, conf.budget * std::max(num_samples, 1u), now)) {
+        case watchdog::event::none:
+            break;
+        case watchdog::event::degraded:
+            stats::channel::bump(counters[channel].degraded);
+            trace::record(trace::kind::degraded, notify::pad::vpad, channel, elapsed);
+            break;
+        case watchdog::event::restored:
+            trace::record(trace::kind::restored, notify::pad::vpad, channel);
+            break;
         }
 
+        busy.clear(std::memory_order_release);
         return result;
     }
 
 
-    WUPS_MUST_REPLACE(VPADRead, WUPS_LOADER_LIBRARY_VPAD, VPADRead);
+    hooks::patch hook{REPLACE_FUNCTION(VPADRead, LIBRARY_VPAD, VPADRead)};
 
 } // namespace vpad
@@ -9,10 +9,46 @@
 #ifndef VPAD_HPP
 #define VPAD_HPP
 
+#include <cstdint>
+
+
+namespace stats {
+    struct channel;
+}
+
+
 namespace vpad {
 
+    inline constexpr unsigned max_vpads = 2;
+
+
     void reset();
 
+    // Whether the hook processed any sample since the last reset().
+    bool hook_ran() noexcept;
+
+    // Note: the channel must be below max_vpads.
+
+    // Turbo buttons of one channel, as last published by the hook, or as given to
+    // set_turbo() if the hook hasn't picked them up yet.
+    std::uint16_t get_turbo(unsigned channel) noexcept;
+
+    // Replace the turbo buttons of one channel; the hook does it on its next sample.
+    void set_turbo(unsigned channel, std::uint16_t buttons) noexcept;
+
+    // Counters kept by the hook for one channel.
+    const stats::channel& get_stats(unsigned channel) noexcept;
+
+    // Wait until every hook that is running right now returns.
+    void synchronize();
+
+    // Activate the VPADRead hook, installing it the first time, or deactivate it, depending
+    // on whether it's needed.
+    void update_hook();
+
+    // Deactivate the hook, wait for it to return, and remove it; only when the title ends.
+    void remove_hook();
+
 } // namespace vpad
 
 #endif
@@ -0,0 +1,160 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include <wupsxx/logger.hpp>
+
+#include "vpad.hpp"
+#include "vpad_shared.hpp"
+
+#include "hooks.hpp"
+#include "lockfree.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+
+
+using std::array;
+
+using namespace std::literals;
+
+namespace logger = wups::logger;
+
+
+namespace vpad {
+
+    array<channel_t, max_vpads> channels;
+
+    lockfree::request reset_request;  // forget everything
+    lockfree::request resume_request; // the hook was idle, forget all but the turbos
+
+    std::atomic<bool> hook_active = false;
+
+
+    // Reset all channels; the hook does it on its next sample, but what other threads
+    // see is cleared right away.
+    void
+    reset()
+    {
+        logger::printf("Resetting vpads\n");
+        reset_request.post();
+        for (auto& chan : channels) {
+            // Note: the summary has a single writer, so take the hook's place.
+            while (chan.busy.test_and_set(std::memory_order_seq_cst))
+                std::this_thread::sleep_for(1ms);
+            chan.summary.store({});
+            chan.load_pending.store(false, std::memory_order_relaxed);
+            chan.ran.store(false, std::memory_order_relaxed);
+            chan.busy.clear(std::memory_order_release);
+        }
+    }
+
+
+    std::uint16_t
+    get_turbo(unsigned channel)
+        noexcept
+    {
+        const auto& chan = channels[channel];
+        // Turbo buttons the hook hasn't picked up yet replace the published ones.
+        if (chan.load_pending.load(std::memory_order_acquire))
+            return chan.loaded_turbo.load(std::memory_order_relaxed);
+        return chan.summary.load().turbo;
+    }
+
+
+    bool
+    hook_ran()
+        noexcept
+    {
+        return std::ranges::any_of(channels,
+                                   [](const channel_t& chan)
+                                   {
+                                       return chan.ran.load(std::memory_order_relaxed);
+                                   });
+    }
+
+
+    const stats::channel&
+    get_stats(unsigned channel)
+        noexcept
+    {
+        return counters[channel];
+    }
+
+
+    void
+    set_turbo(unsigned channel,
+              std::uint16_t buttons)
+        noexcept
+    {
+        auto& chan = channels[channel];
+        chan.loaded_turbo.store(buttons & kernel::mask, std::memory_order_relaxed);
+        chan.load_pending.store(true, std::memory_order_release);
+    }
+
+
+    // The hook is needed while a combo can start toggling or a macro, a button is remapped,
+    // or a turbo button is set.
+    bool
+    hook_needed()
+    {
+        if (!snapshot::enabled())
+            return false;
+        if (snapshot::wants_vpad_hook())
+            return true;
+        return std::ranges::any_of(channels,
+                                   [](const channel_t& chan)
+                                   {
+                                       if (chan.load_pending.load(std::memory_order_acquire))
+                                           return true;
+                                       const auto summary = chan.summary.load();
+                                       return summary.turbo || summary.toggling;
+                                   });
+    }
+
+
+    void
+    synchronize()
+    {
+        for (auto& chan : channels)
+            // Note: sleep instead of yielding, the hook may be in a lower priority thread.
+            while (chan.busy.test(std::memory_order_seq_cst))
+                std::this_thread::sleep_for(1ms);
+    }
+
+
+    void
+    update_hook()
+    {
+        const bool needed = hook_needed();
+        if (needed) {
+            if (!hook_active.load(std::memory_order_relaxed))
+                // Whatever happened while the hook was idle is unknown, only keep the turbos.
+                resume_request.post();
+            hook.install();
+        }
+        // Note: a game thread may be inside the hook at any time, so it's never removed
+        // here; removing a patch would free the trampoline the hook returns through.
+        hook_active.store(needed, std::memory_order_seq_cst);
+    }
+
+
+    void
+    remove_hook()
+    {
+        hook_active.store(false, std::memory_order_seq_cst);
+        synchronize();
+        hook.remove();
+    }
+
+} // namespace vpad
@@ -0,0 +1,90 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef VPAD_SHARED_HPP
+#define VPAD_SHARED_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <vpad/input.h>
+
+#include "vpad.hpp"
+
+#include "hooks.hpp"
+#include "lockfree.hpp"
+#include "stats.hpp"
+#include "turbo.hpp"
+
+
+/*
+ * The VPADRead() hook is built without exceptions (see Makefile.am), so only the hook is
+ * in vpad.cpp; everything other threads call is in vpad_control.cpp, built normally. This
+ * is what they share.
+ */
+
+namespace vpad {
+
+    inline constexpr std::array button_list = {
+        VPAD_BUTTON_A,
+        VPAD_BUTTON_B,
+        VPAD_BUTTON_X,
+        VPAD_BUTTON_Y,
+        VPAD_BUTTON_LEFT,
+        VPAD_BUTTON_RIGHT,
+        VPAD_BUTTON_UP,
+        VPAD_BUTTON_DOWN,
+        VPAD_BUTTON_L,
+        VPAD_BUTTON_ZL,
+        VPAD_BUTTON_R,
+        VPAD_BUTTON_ZR,
+        VPAD_BUTTON_PLUS,
+        VPAD_BUTTON_MINUS,
+    };
+
+    using kernel = turbo::kernel<button_list>;
+
+    static_assert(sizeof(kernel::mask_type) == sizeof(std::uint16_t));
+
+
+    // What other threads can know about a channel.
+    struct summary_t {
+        std::uint16_t turbo    = 0;
+        bool          toggling = false;
+    };
+
+
+    // The part of a channel that is shared with other threads.
+    struct channel_t {
+        std::atomic_flag busy; // a hook is processing this channel
+        std::atomic<bool> ran = false; // the hook processed a sample since the last reset()
+        lockfree::seqlock<summary_t> summary;
+        // Turbo buttons set by set_turbo(), waiting for the hook.
+        std::atomic<std::uint16_t> loaded_turbo = 0;
+        std::atomic<bool>          load_pending = false;
+    };
+
+
+    extern std::array<channel_t, max_vpads> channels;
+
+    extern lockfree::request reset_request;  // forget everything
+    extern lockfree::request resume_request; // the hook was idle, forget all but the turbos
+
+    // The hook stays installed while the title runs, but only does something while this is
+    // set; see update_hook().
+    extern std::atomic<bool> hook_active;
+
+    // Only the hook writes to these.
+    extern std::array<stats::channel, max_vpads> counters;
+
+    extern hooks::patch hook;
+
+} // namespace vpad
+
+#endif
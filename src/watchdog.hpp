@@ -0,0 +1,116 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef WATCHDOG_HPP
+#define WATCHDOG_HPP
+
+#include <cstdint>
+
+#include <coreinit/time.h>
+
+
+/*
+ * Time budget for the input hooks.
+ *
+ * When a channel keeps going over the budget, its hook leaves the input alone for a while,
+ * so Turbiine can't make the game miss frames. Then it tries again: if that call is within
+ * the budget, full processing is back.
+ */
+
+namespace watchdog {
+
+    // Consecutive calls over the budget before the channel is left alone.
+    inline constexpr unsigned max_overruns = 3;
+
+
+    // What the hook should do with this call.
+    enum class verdict : std::uint8_t {
+        run,    // process the input
+        skip,   // leave the input alone
+        resume, // process the input, but the channel state is stale
+    };
+
+
+    enum class event : std::uint8_t {
+        none,
+        degraded, // the channel is left alone now
+        restored, // the channel is processed again
+    };
+
+
+    // Only the hook of the channel touches it.
+    class state {
+
+        enum class mode : std::uint8_t {
+            normal,
+            passthrough,
+            probing, // trying to process the input again
+        };
+
+        mode          current    = mode::normal;
+        std::uint8_t  overruns   = 0;
+        std::uint32_t retry_time = 0; // OSGetSystemTick() when it tries again
+
+
+        void
+        leave_alone(std::uint32_t now)
+            noexcept
+        {
+            current    = mode::passthrough;
+            overruns   = 0;
+            retry_time = now + OSTimerClockSpeed; // one second
+        }
+
+    public:
+
+        verdict
+        admit(std::uint32_t now)
+            noexcept
+        {
+            if (current != mode::passthrough) [[likely]]
+                return verdict::run;
+            // Note: 32-bit ticks wrap around, so they're only compared through differences.
+            if (static_cast<std::int32_t>(now - retry_time) < 0)
+                return verdict::skip;
+            current = mode::probing;
+            return verdict::resume;
+        }
+
+
+        // How long the call took, and how long it could take; a budget of 0 is no limit.
+        event
+        check(std::uint32_t elapsed,
+              std::uint32_t budget,
+              std::uint32_t now)
+            noexcept
+        {
+            if (!budget || elapsed <= budget) [[likely]] {
+                overruns = 0;
+                if (current == mode::probing) [[unlikely]] {
+                    current = mode::normal;
+                    return event::restored;
+                }
+                return event::none;
+            }
+
+            // Note: a failed retry goes back to pass-through quietly.
+            if (current == mode::probing) {
+                leave_alone(now);
+                return event::none;
+            }
+            if (++overruns < max_overruns)
+                return event::none;
+            leave_alone(now);
+            return event::degraded;
+        }
+
+    };
+
+} // namespace watchdog
+
+#endif
@@ -0,0 +1,85 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <chrono>
+#include <exception>
+#include <thread>
+
+#ifdef __WIIU__
+#include <coreinit/thread.h>
+#endif
+
+#include <wupsxx/logger.hpp>
+
+#include "worker.hpp"
+
+#include "capture.hpp"
+#include "cfg.hpp"
+#include "hooks.hpp"
+#include "notify.hpp"
+#include "trace.hpp"
+
+
+using namespace std::literals;
+
+namespace logger = wups::logger;
+
+
+namespace worker {
+
+    // How often the thread checks for new work.
+    const auto poll_interval = 50ms;
+
+
+    std::jthread thread;
+
+
+    void
+    loop(std::stop_token token)
+    {
+#ifdef __WIIU__
+        // Stay out of the way of the game threads.
+        OSSetThreadPriority(OSGetCurrentThread(), 30);
+#endif
+        while (!token.stop_requested()) {
+            try {
+                notify::flush();
+                trace::flush();
+                capture::flush();
+                cfg::flush();
+                // Deactivate the hooks when there's nothing left for them to do.
+                hooks::update();
+            }
+            catch (std::exception& e) {
+                logger::printf("Worker error: %s\n", e.what());
+            }
+            std::this_thread::sleep_for(poll_interval);
+        }
+    }
+
+
+    void
+    initialize()
+    {
+        thread = std::jthread{loop};
+    }
+
+
+    void
+    finalize()
+    {
+        if (thread.joinable()) {
+            thread.request_stop();
+            thread.join();
+        }
+        trace::flush();
+        capture::finish();
+        cfg::flush(true);
+    }
+
+} // namespace worker
@@ -0,0 +1,23 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef WORKER_HPP
+#define WORKER_HPP
+
+
+// Low priority background thread, that does the slow work queued up by the input hooks.
+
+namespace worker {
+
+    void initialize();
+
+    void finalize();
+
+} // namespace worker
+
+#endif
@@ -8,24 +8,27 @@
 
 #include <algorithm>
 #include <array>
-#include <bitset>
-#include <concepts>
+#include <atomic>
 #include <cstdint>
-#include <ranges>
-#include <variant>
 
 // #include <coreinit/thread.h> // DEBUG
+#include <coreinit/time.h>
 #include <padscore/wpad.h>
 
-#include <wups/function_patching.h>
-
-#include <wupsxx/button_combo.hpp>
-#include <wupsxx/logger.hpp>
-
 #include "wpad.hpp"
+#include "wpad_shared.hpp"
 
-#include "cfg.hpp"
+#include "capture.hpp"
+#include "combo.hpp"
+#include "hooks.hpp"
+#include "macro.hpp"
 #include "notify.hpp"
+#include "remap.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+#include "turbo.hpp"
+#include "watchdog.hpp"
 
 // Borrow this header from libwupsxx, since WUT doesn't have these definitions.
 #include <wupsxx/../../src/wpad_status.h>
@@ -34,190 +37,97 @@
 using std::array;
 using std::int32_t;
 using std::uint32_t;
-using std::uint8_t;
-using std::views::enumerate;
-
-using wups::utils::button_combo;
-
-namespace logger = wups::logger;
 
 
 namespace wpad {
 
-    template<typename... Ts>
-    struct overloaded : Ts... {
-        using Ts::operator ()...;
-    };
-
-
-    template<typename T,
-             typename... Ts>
-    T&
-    ensure(std::variant<Ts...>& v)
-    {
-        if (!holds_alternative<T>(v))
-            v = T{};
-        return get<T>(v);
-    }
-
-
-    constexpr unsigned max_wpads = 7;
-
-
-    namespace core {
-
-        constexpr array button_list = {
-            WPAD_BUTTON_LEFT,
-            WPAD_BUTTON_RIGHT,
-            WPAD_BUTTON_DOWN,
-            WPAD_BUTTON_UP,
-            WPAD_BUTTON_PLUS,
-            WPAD_BUTTON_2,
-            WPAD_BUTTON_1,
-            WPAD_BUTTON_B,
-            WPAD_BUTTON_A,
-            WPAD_BUTTON_MINUS,
-        };
-
-        constexpr unsigned max_buttons = button_list.size();
-
-        using button_set = std::bitset<max_buttons>;
-
-        struct pad_state_t {
-            button_set turbo;
-            button_set fake_hold;
-            button_set suppress;
-            array<uint8_t, max_buttons> age{};
-        };
-
-    } // namespace core
-
-
-    namespace nunchuk {
-
-        constexpr array button_list = {
-            WPAD_NUNCHUK_BUTTON_Z,
-            WPAD_NUNCHUK_BUTTON_C,
-        };
-
-        constexpr unsigned max_buttons = button_list.size();
-
-        using button_set = std::bitset<max_buttons>;
-
-        struct pad_state_t {
-            button_set turbo;
-            button_set fake_hold;
-            button_set suppress;
-            array<uint8_t, max_buttons> age{};
-        };
-
-    } // namespace nunchuk
-
-
-    namespace classic {
-
-        constexpr array button_list = {
-            WPAD_CLASSIC_BUTTON_UP,
-            WPAD_CLASSIC_BUTTON_LEFT,
-            WPAD_CLASSIC_BUTTON_ZR,
-            WPAD_CLASSIC_BUTTON_X,
-            WPAD_CLASSIC_BUTTON_A,
-            WPAD_CLASSIC_BUTTON_Y,
-            WPAD_CLASSIC_BUTTON_B,
-            WPAD_CLASSIC_BUTTON_ZL,
-            WPAD_CLASSIC_BUTTON_R,
-            WPAD_CLASSIC_BUTTON_PLUS,
-            WPAD_CLASSIC_BUTTON_MINUS,
-            WPAD_CLASSIC_BUTTON_L,
-            WPAD_CLASSIC_BUTTON_DOWN,
-            WPAD_CLASSIC_BUTTON_RIGHT,
-        };
-
-        constexpr unsigned max_buttons = button_list.size();
-
-        using button_set = std::bitset<max_buttons>;
-
-        struct pad_state_t {
-            button_set turbo;
-            button_set fake_hold;
-            button_set suppress;
-            array<uint8_t, max_buttons> age{};
-        };
-
-    } // namespace classic
-
-
-    namespace pro {
-
-        constexpr array button_list = {
-            WPAD_PRO_BUTTON_UP,
-            WPAD_PRO_BUTTON_LEFT,
-            WPAD_PRO_TRIGGER_ZR,
-            WPAD_PRO_BUTTON_X,
-            WPAD_PRO_BUTTON_A,
-            WPAD_PRO_BUTTON_Y,
-            WPAD_PRO_BUTTON_B,
-            WPAD_PRO_TRIGGER_ZL,
-            WPAD_PRO_TRIGGER_R,
-            WPAD_PRO_BUTTON_PLUS,
-            WPAD_PRO_BUTTON_MINUS,
-            WPAD_PRO_TRIGGER_L,
-            WPAD_PRO_BUTTON_DOWN,
-            WPAD_PRO_BUTTON_RIGHT,
-        };
-
-        constexpr unsigned max_buttons = button_list.size();
-
-        using button_set = std::bitset<max_buttons>;
-
-        struct pad_state_t {
-            button_set turbo;
-            button_set fake_hold;
-            button_set suppress;
-            array<uint8_t, max_buttons> age{};
-        };
-
-    } // namespace pro
-
-
-    using ext_state_t = std::variant<std::monostate,
-                                     nunchuk::pad_state_t,
-                                     classic::pad_state_t,
-                                     pro::pad_state_t>;
-
-
-    struct pad_state_t {
-
-        core::pad_state_t core;
-        ext_state_t  ext;
-        bool toggling = false;
+    /*
+     * State for one channel.
+     *
+     * The state for every extension is always present, so the turbo buttons survive
+     * extension hot-swaps, and no dispatch is needed to find it. Byte budget:
+     *
+     *   core      36  (5 x 2 bytes masks + 13 ages + 13 steps)
+     *   nunchuk   14  (5 x 2 bytes masks + 2 ages + 2 steps)
+     *   classic   42  (5 x 2 bytes masks + 16 ages + 16 steps)
+     *   pro       42  (5 x 2 bytes masks + 16 ages + 16 steps)
+     *   flags      4
+     *   real hold  6  (core + extension)
+     *   clock     12
+     *
+     * That's 156 bytes, aligned to 160, so each channel owns exactly 5 cache lines.
+     */
+    struct alignas(32) pad_state_t {
+
+        core::pad_state_t    core;
+        nunchuk::pad_state_t nunchuk;
+        classic::pad_state_t classic;
+        pro::pad_state_t     pro;
+        std::uint8_t         ext_type = WPAD_EXT_CORE;
+        bool                 toggling = false;
+        std::uint8_t         reset_seen  = 0; // last request applied, see apply_requests()
+        std::uint8_t         resume_seen = 0;
+        std::uint16_t        real_core = 0; // core buttons held in the last sample
+        std::uint32_t        real_ext  = 0; // extension buttons held in the last sample
+        turbo::clock         clock;
+
+
+        // When the extension changes, forget all extension state except the turbo buttons.
+        void
+        update_ext_type(std::uint8_t new_ext_type)
+            noexcept
+        {
+            if (new_ext_type == ext_type) [[likely]]
+                return;
+            ext_type = new_ext_type;
+            real_ext = 0;
+            nunchuk.clear_transient();
+            classic.clear_transient();
+            pro.clear_transient();
+        }
 
 
-        bool
-        no_ext_turbo()
-            const
+        // Keep these buttons suppressed until they're released, without clearing them.
+        void
+        suppress_held(std::uint8_t type,
+                      std::uint32_t core_hold,
+                      std::uint32_t ext_hold)
+            noexcept
         {
-            return visit(overloaded{[](std::monostate) { return true; },
-                                    [](const auto& st) { return st.turbo.none(); }},
-                         ext);
+            switch (type) {
+            case WPAD_EXT_CORE:
+            case WPAD_EXT_MPLUS:
+                core.suppress |= core_hold & core::kernel::mask;
+                break;
+            case WPAD_EXT_NUNCHUK:
+            case WPAD_EXT_MPLUS_NUNCHUK:
+                core.suppress    |= core_hold & core::kernel::mask;
+                nunchuk.suppress |= core_hold & nunchuk::kernel::mask;
+                break;
+            case WPAD_EXT_CLASSIC:
+            case WPAD_EXT_MPLUS_CLASSIC:
+                core.suppress    |= core_hold & core::kernel::mask;
+                classic.suppress |= ext_hold & classic::kernel::mask;
+                break;
+            case WPAD_EXT_PRO_CONTROLLER:
+                pro.suppress |= ext_hold & pro::kernel::mask;
+                break;
+            }
         }
 
 
         void
         clear_and_suppress_buttons(WPADStatus* status)
+            noexcept
         {
             switch (status->extensionType) {
 
             case WPAD_EXT_CORE:
             case WPAD_EXT_MPLUS:
                 // Keep all held buttons suppressed
-                for (auto [idx, btn] : enumerate(core::button_list))
-                    if (status->buttons & btn)
-                        core.suppress.set(idx);
+                core.suppress |= status->buttons & core::kernel::mask;
                 // Clear buttons.
                 status->buttons = 0;
-                // Get rid of any extension state.
-                ext = std::monostate{};
                 break;
 
             case WPAD_EXT_NUNCHUK:
@@ -225,14 +135,9 @@ namespace wpad {
                 {
                     auto xstatus = reinterpret_cast<WPADNunchukStatus*>(status);
                     // Keep all held core buttons suppressed.
-                    for (auto [idx, btn] : enumerate(core::button_list))
-                        if (xstatus->core.buttons & btn)
-                            core.suppress.set(idx);
+                    core.suppress |= xstatus->core.buttons & core::kernel::mask;
                     // Keep all nunchuk buttons suppressed.
-                    auto& xext = ensure<nunchuk::pad_state_t>(ext);
-                    for (auto [idx, btn] : enumerate(nunchuk::button_list))
-                        if (xstatus->core.buttons & btn)
-                            xext.suppress.set(idx);
+                    nunchuk.suppress |= xstatus->core.buttons & nunchuk::kernel::mask;
                     // Clear buttons: both core and nunchuk are stored here.
                     xstatus->core.buttons = 0;
                 }
@@ -243,14 +148,9 @@ namespace wpad {
                 {
                     auto xstatus = reinterpret_cast<WPADClassicStatus*>(status);
                     // Keep all held core buttons suppressed.
-                    for (auto [idx, btn] : enumerate(core::button_list))
-                        if (xstatus->core.buttons & btn)
-                            core.suppress.set(idx);
+                    core.suppress |= xstatus->core.buttons & core::kernel::mask;
                     // Keep all classic buttons suppressed.
-                    auto& xext = ensure<classic::pad_state_t>(ext);
-                    for (auto [idx, btn] : enumerate(classic::button_list))
-                        if (xstatus->ext.buttons & btn)
-                            xext.suppress.set(idx);
+                    classic.suppress |= xstatus->ext.buttons & classic::kernel::mask;
                     // Clear buttons.
                     xstatus->core.buttons = 0;
                     xstatus->ext.buttons = 0;
@@ -261,10 +161,7 @@ namespace wpad {
                 {
                     auto xstatus = reinterpret_cast<WPADProStatus*>(status);
                     // Keep all pro buttons suppressed.
-                    auto& xext = ensure<pro::pad_state_t>(ext);
-                    for (auto [idx, btn] : enumerate(pro::button_list))
-                        if (xstatus->ext.buttons & btn)
-                            xext.suppress.set(idx);
+                    pro.suppress |= xstatus->ext.buttons & pro::kernel::mask;
                     // Clear buttons.
                     xstatus->ext.buttons = 0;
                     // Note: we ignore core buttons, they're not supposed to be set.
@@ -276,375 +173,491 @@ namespace wpad {
 
     };
 
+    static_assert(sizeof(pad_state_t) == 160);
 
+    // Only the hook touches these.
     array<pad_state_t, max_wpads> pads;
+    array<macro::tape, max_wpads> tapes;
+    array<stats::channel, max_wpads> counters;
+    array<watchdog::state, max_wpads> watchdogs;
 
 
-    // Reset all variables
     void
-    reset()
+    publish(const pad_state_t& pad,
+            WPADChan channel)
+        noexcept
     {
-        pads.fill({});
+        channels[channel].summary.store({
+                .turbo = {
+                    .core    = pad.core.turbo,
+                    .nunchuk = pad.nunchuk.turbo,
+                    .classic = pad.classic.turbo,
+                    .pro     = pad.pro.turbo
+                },
+                .toggling = pad.toggling
+            });
     }
 
 
-    wups::utils::wpad::core::button_set
-    make_button_set(WPADButton b)
+    // The samples since the last one seen are unknown, forget all but the turbos.
+    void
+    resume(pad_state_t& pad,
+           WPADChan channel)
+        noexcept
     {
-        return {b};
+        pad.core.clear_transient();
+        pad.nunchuk.clear_transient();
+        pad.classic.clear_transient();
+        pad.pro.clear_transient();
+        pad.toggling  = false;
+        pad.real_core = 0;
+        pad.real_ext  = 0;
+        tapes[channel].stop();
     }
 
 
-    wups::utils::wpad::ext_button_set
-    make_button_set(WPADNunchukButton b)
+    // Apply the requests posted by other threads.
+    void
+    apply_requests(pad_state_t& pad,
+                   WPADChan channel)
+        noexcept
     {
-        return wups::utils::wpad::nunchuk::button_set{b};
-    }
-
+        bool changed = false;
+
+        if (reset_request.take(pad.reset_seen)) [[unlikely]] {
+            const std::uint8_t reset_seen  = pad.reset_seen;
+            const std::uint8_t resume_seen = pad.resume_seen;
+            pad = {};
+            pad.reset_seen  = reset_seen;
+            pad.resume_seen = resume_seen;
+            tapes[channel] = {};
+            watchdogs[channel] = {};
+            changed = true;
+        }
 
-    wups::utils::wpad::ext_button_set
-    make_button_set(WPADClassicButton b)
-    {
-        return wups::utils::wpad::classic::button_set{b};
-    }
+        if (resume_request.take(pad.resume_seen)) [[unlikely]] {
+            resume(pad, channel);
+            changed = true;
+        }
 
+        auto& chan = channels[channel];
+        if (chan.load_pending.load(std::memory_order_relaxed)) [[unlikely]]
+            if (chan.load_pending.exchange(false, std::memory_order_acquire)) {
+                pad.core.clear_transient();
+                pad.nunchuk.clear_transient();
+                pad.classic.clear_transient();
+                pad.pro.clear_transient();
+                pad.core.turbo    = chan.loaded_core.load(std::memory_order_relaxed);
+                pad.nunchuk.turbo = chan.loaded_nunchuk.load(std::memory_order_relaxed);
+                pad.classic.turbo = chan.loaded_classic.load(std::memory_order_relaxed);
+                pad.pro.turbo     = chan.loaded_pro.load(std::memory_order_relaxed);
+                tapes[channel].stop();
+                changed = true;
+            }
 
-    wups::utils::wpad::ext_button_set
-    make_button_set(WPADProButton b)
-    {
-        return wups::utils::wpad::pro::button_set{b};
+        if (changed)
+            publish(pad, channel);
     }
 
 
-    template<typename Trb,
-             typename Btn>
     void
-    toggle_button(pad_state_t& pad,
-                  Trb& turbo,
-                  unsigned idx,
-                  Btn btn,
+    toggle_button(notify::pad source,
+                  std::uint32_t turbo,
+                  std::uint32_t btn,
                   WPADChan channel)
+        noexcept
     {
-        pad.toggling = false;
-
-        turbo.flip(idx);
+        const bool on = turbo & btn;
+        notify::post({
+                .source  = source,
+                .kind    = on ? notify::what::turbo : notify::what::normal,
+                .channel = static_cast<std::uint8_t>(channel),
+                .button  = btn
+            });
+        trace::record(on ? trace::kind::turbo : trace::kind::normal,
+                      source, channel, btn);
+    }
 
-        wups::utils::wpad::button_set bs = make_button_set(btn);
 
-        const char* on_off = turbo.test(idx) ? "turbo" : "normal";
-        notify::info("%s = %s",
-                     to_glyph(bs).c_str(),
-                     on_off);
+    // Run the turbo kernel on one family of buttons, stored in the "buttons" field.
+    template<typename Kernel,
+             notify::pad source,
+             typename T>
+    void
+    run_turbo_logic(pad_state_t& pad,
+                    typename Kernel::state& xpad,
+                    const turbo::edges& e,
+                    T& buttons,
+                    WPADChan channel,
+                    turbo::phase ph,
+                    const snapshot::config& conf)
+        noexcept
+    {
+        auto out = Kernel::run(xpad, pad.toggling,
+                               e.hold, e.trigger, e.release,
+                               ph, conf.get_patterns(source));
+        counters[channel].add(out);
+
+        if (out.toggled) [[unlikely]] {
+            toggle_button(source, xpad.turbo, out.toggled, channel);
+            publish(pad, channel);
+        }
 
-        logger::printf("wpad %u button %s [%u] = %s\n",
-                       unsigned{channel},
-                       to_string(bs).c_str(),
-                       idx,
-                       on_off);
+        turbo::apply(out, buttons);
     }
 
 
     void
-    run_turbo_logic_core(pad_state_t& pad,
-                         WPADStatus* status,
-                         WPADChan channel)
+    run_turbo_logic(pad_state_t& pad,
+                    WPADStatus* status,
+                    WPADChan channel,
+                    const turbo::edges& core,
+                    const turbo::edges& ext,
+                    const snapshot::config& conf)
+        noexcept
     {
-        const auto& state = wups::utils::wpad::get_button_state(channel);
+        // Note: core and extension buttons advance by the same phase.
+        const auto ph = pad.clock.tick(conf.period, conf.rate, conf.sync);
 
-        for (auto [idx, btn] : enumerate(core::button_list)) {
-            const auto not_btn = ~uint32_t{btn};
+        switch (status->extensionType) {
 
-            // If this is a suppressed button, don't process it, keep it clear and
-            // skip further turbo processing.
-            if (pad.core.suppress.test(idx)) {
-                // if the button is not held, or was released, we stop supressing it
-                if (!(state.core.hold & btn) || (state.core.release & btn))
-                    pad.core.suppress.reset(idx);
+        case WPAD_EXT_CORE:
+        case WPAD_EXT_MPLUS:
+            run_turbo_logic<core::kernel,
+                            notify::pad::wpad_core>(pad, pad.core, core,
+                                                    status->buttons,
+                                                    channel, ph, conf);
+            break;
 
-                status->buttons &= not_btn;
+        case WPAD_EXT_NUNCHUK:
+        case WPAD_EXT_MPLUS_NUNCHUK:
+            run_turbo_logic<core::kernel,
+                            notify::pad::wpad_core>(pad, pad.core, core,
+                                                    status->buttons,
+                                                    channel, ph, conf);
+            // Note: nunchuk buttons are stored together with the core buttons.
+            run_turbo_logic<nunchuk::kernel,
+                            notify::pad::wpad_nunchuk>(pad, pad.nunchuk, core,
+                                                       status->buttons,
+                                                       channel, ph, conf);
+            break;
 
-                continue;
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            {
+                auto xstatus = reinterpret_cast<WPADClassicStatus*>(status);
+                run_turbo_logic<core::kernel,
+                                notify::pad::wpad_core>(pad, pad.core, core,
+                                                        xstatus->core.buttons,
+                                                        channel, ph, conf);
+                run_turbo_logic<classic::kernel,
+                                notify::pad::wpad_classic>(pad, pad.classic, ext,
+                                                           xstatus->ext.buttons,
+                                                           channel, ph, conf);
             }
+            break;
 
-            if (pad.toggling && (state.core.trigger & btn)) {
-
-                // We're in the toggling state, and a button was triggered.
-                toggle_button(pad, pad.core.turbo, idx, btn, channel);
-
-                // Hide this event from the game.
-                status->buttons &= not_btn;
-
-                pad.core.fake_hold.reset(idx);
-
-                // This button will be suppressed until a release event happens.
-                pad.core.suppress.set(idx);
-
-                pad.core.age[idx] = 0;
-
-            } else {
-
-                // We're not in the toggling state, just check if it's a turbinated button
-                // held down.
-
-                bool turbinated = pad.core.turbo.test(idx);
-                if (turbinated && (state.core.hold & btn)) {
-
-                    if (++pad.core.age[idx] >= cfg::period) {
-
-                        pad.core.fake_hold.flip(idx);
-                        pad.core.age[idx] = 0;
-
-                        if (pad.core.fake_hold.test(idx))
-                            status->buttons |= btn; // simulate a press event
-                        else
-                            status->buttons &= not_btn; // simulate a release event
-
-                    }
-
-                } else // if no turbo action, just copy the real button state
-                    pad.core.fake_hold.set(idx, status->buttons & btn);
-
+        case WPAD_EXT_PRO_CONTROLLER:
+            {
+                auto xstatus = reinterpret_cast<WPADProStatus*>(status);
+                run_turbo_logic<pro::kernel,
+                                notify::pad::wpad_pro>(pad, pad.pro, ext,
+                                                       xstatus->ext.buttons,
+                                                       channel, ph, conf);
             }
+            break;
+
         }
     }
 
 
-    void
-    run_turbo_logic_ext(pad_state_t& pad,
-                        WPADNunchukStatus* status,
-                        WPADChan channel)
+    // Match the combos for the extension currently attached.
+    combo::action
+    combo_triggered(std::uint8_t ext_type,
+                    const turbo::edges& core,
+                    const turbo::edges& ext,
+                    const snapshot::config& conf)
+        noexcept
     {
-        auto& xpad = ensure<nunchuk::pad_state_t>(pad.ext);
-        const auto& state = wups::utils::wpad::get_button_state(channel);
-        const auto& xstate = get<wups::utils::wpad::nunchuk_button_state>(state.ext);
+        switch (ext_type) {
 
-        for (auto [idx, btn] : enumerate(nunchuk::button_list)) {
-            const auto not_btn = ~uint32_t{btn};
-
-            // If this is a suppressed button, don't process it, keep it clear and
-            // skip further turbo processing.
-            if (xpad.suppress.test(idx)) {
-                // if the button is not held, or was released, we stop supressing it
-                if (!(xstate.hold & btn) || (xstate.release & btn))
-                    xpad.suppress.reset(idx);
+        case WPAD_EXT_CORE:
+        case WPAD_EXT_MPLUS:
+            return conf.get_combos(notify::pad::wpad_core).triggered(core.hold,
+                                                                     core.trigger);
 
-                status->core.buttons &= not_btn;
+        case WPAD_EXT_NUNCHUK:
+        case WPAD_EXT_MPLUS_NUNCHUK:
+            // Note: nunchuk buttons are stored together with the core buttons.
+            return conf.get_combos(notify::pad::wpad_nunchuk).triggered(core.hold,
+                                                                        core.trigger);
 
-                continue;
-            }
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            return conf.get_combos(notify::pad::wpad_classic).triggered(core.hold,
+                                                                        core.trigger,
+                                                                        ext.hold,
+                                                                        ext.trigger);
 
-            if (pad.toggling && (xstate.trigger & btn)) {
+        case WPAD_EXT_PRO_CONTROLLER:
+            return conf.get_combos(notify::pad::wpad_pro).triggered(core.hold,
+                                                                    core.trigger,
+                                                                    ext.hold,
+                                                                    ext.trigger);
 
-                // We're in the toggling state, and a button was triggered.
-                toggle_button(pad, xpad.turbo, idx, btn, channel);
+        default:
+            return combo::action::none;
 
-                // Hide this event from the game.
-                status->core.buttons &= not_btn;
+        }
+    }
 
-                xpad.fake_hold.reset(idx);
 
-                // This button will be suppressed until a release event happens.
-                xpad.suppress.set(idx);
+    // Which family of buttons the extension has.
+    notify::pad
+    family_of(std::uint8_t ext_type)
+        noexcept
+    {
+        switch (ext_type) {
+        case WPAD_EXT_NUNCHUK:
+        case WPAD_EXT_MPLUS_NUNCHUK:
+            return notify::pad::wpad_nunchuk;
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            return notify::pad::wpad_classic;
+        case WPAD_EXT_PRO_CONTROLLER:
+            return notify::pad::wpad_pro;
+        default:
+            return notify::pad::wpad_core;
+        }
+    }
 
-                xpad.age[idx] = 0;
 
-            } else {
+    // The extension buttons, if they're stored separately from the core buttons.
+    uint32_t
+    get_ext_buttons(const WPADStatus* status)
+        noexcept
+    {
+        switch (status->extensionType) {
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            return reinterpret_cast<const WPADClassicStatus*>(status)->ext.buttons;
+        case WPAD_EXT_PRO_CONTROLLER:
+            return reinterpret_cast<const WPADProStatus*>(status)->ext.buttons;
+        default:
+            return 0;
+        }
+    }
 
-                // We're not in the toggling state, just check if it's a turbinated button
-                // held down.
 
-                bool turbinated = xpad.turbo.test(idx);
-                if (turbinated && (xstate.hold & btn)) {
+    // The buttons a macro records and plays, in the "buttons" field and in the extension.
+    macro::sample
+    macro_mask(std::uint8_t ext_type)
+        noexcept
+    {
+        switch (ext_type) {
+        case WPAD_EXT_NUNCHUK:
+        case WPAD_EXT_MPLUS_NUNCHUK:
+            return {core::kernel::mask | nunchuk::kernel::mask, 0};
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            return {core::kernel::mask, classic::kernel::mask};
+        case WPAD_EXT_PRO_CONTROLLER:
+            // Note: we ignore core buttons, they're not supposed to be set.
+            return {0, pro::kernel::mask};
+        default:
+            return {core::kernel::mask, 0};
+        }
+    }
 
-                    if (++xpad.age[idx] >= cfg::period) {
 
-                        xpad.fake_hold.flip(idx);
-                        xpad.age[idx] = 0;
+    // Record the real buttons, or replace them by the macro, before the turbo logic.
+    // Returns true when the playback ended with this sample.
+    bool
+    run_macro(pad_state_t& pad,
+              macro::tape& tape,
+              WPADStatus* status,
+              WPADChan channel,
+              turbo::edges& core,
+              turbo::edges& ext)
+        noexcept
+    {
+        const auto ext_type = status->extensionType;
+        // The tape only makes sense with the extension it was recorded with.
+        if (tape.ext_type != ext_type) [[unlikely]] {
+            const bool was_playing = tape.state == macro::tape::mode::playing;
+            macro::stop(tape, notify::pad::wpad_core, channel);
+            // The game never saw the real buttons pressed.
+            if (was_playing)
+                pad.clear_and_suppress_buttons(status);
+            return false;
+        }
 
-                        if (xpad.fake_hold.test(idx))
-                            status->core.buttons |= btn; // simulate a press event
-                        else
-                            status->core.buttons &= not_btn; // simulate a release event
+        const auto mask = macro_mask(ext_type);
 
-                    }
+        if (tape.state == macro::tape::mode::recording) {
+            macro::record(tape, {core.hold & mask.core, ext.hold & mask.ext},
+                          notify::pad::wpad_core, channel);
+            return false;
+        }
 
-                } else // if no turbo action, just copy the real button state
-                    xpad.fake_hold.set(idx, status->core.buttons & btn);
+        turbo::edges mcore, mext;
+        const auto s = macro::play(tape, mcore, mext, notify::pad::wpad_core, channel);
+        status->buttons = (status->buttons & ~mask.core) | s.core;
+        core = mcore;
 
+        // Note: for the classic and pro, the extension buttons are stored separately.
+        switch (ext_type) {
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            {
+                auto& buttons = reinterpret_cast<WPADClassicStatus*>(status)->ext.buttons;
+                buttons = (buttons & ~mask.ext) | s.ext;
+                ext = mext;
             }
-
+            break;
+        case WPAD_EXT_PRO_CONTROLLER:
+            {
+                auto& buttons = reinterpret_cast<WPADProStatus*>(status)->ext.buttons;
+                buttons = (buttons & ~mask.ext) | s.ext;
+                ext = mext;
+            }
+            break;
         }
-
+        return tape.idle();
     }
 
 
+    template<typename T>
     void
-    run_turbo_logic_ext(pad_state_t& pad,
-                        WPADClassicStatus* status,
-                        WPADChan channel)
+    apply_remap(const remap::table& map,
+                T& buttons)
+        noexcept
     {
-        auto& xpad = ensure<classic::pad_state_t>(pad.ext);
-        const auto& state = wups::utils::wpad::get_button_state(channel);
-        const auto& xstate = get<wups::utils::wpad::classic_button_state>(state.ext);
-
-        for (auto [idx, btn] : enumerate(classic::button_list)) {
-            const auto not_btn = ~uint32_t{btn};
-
-            // If this is a suppressed button, don't process it, keep it clear and
-            // skip further turbo processing.
-            if (xpad.suppress.test(idx)) {
-                // if the button is not held, or was released, we stop supressing it
-                if (!(xstate.hold & btn) || (xstate.release & btn))
-                    xpad.suppress.reset(idx);
-
-                status->ext.buttons &= not_btn;
-                continue;
-            }
-
-            if (pad.toggling && (xstate.trigger & btn)) {
-
-                // We're in the toggling state, and a button was triggered.
-                toggle_button(pad, xpad.turbo, idx, btn, channel);
-
-                // Hide this event from the game.
-                status->ext.buttons &= not_btn;
-
-                xpad.fake_hold.reset(idx);
-
-                // This button will be suppressed until a release event happens.
-                xpad.suppress.set(idx);
-
-                xpad.age[idx] = 0;
-
-            } else {
-
-                // We're not in the toggling state, just check if it's a turbinated button
-                // held down.
-
-                bool turbinated = xpad.turbo.test(idx);
-                if (turbinated && (xstate.hold & btn)) {
-
-                    if (++xpad.age[idx] >= cfg::period) {
-
-                        xpad.fake_hold.flip(idx);
-                        xpad.age[idx] = 0;
-
-                        if (xpad.fake_hold.test(idx))
-                            status->ext.buttons |= btn; // simulate a press event
-                        else
-                            status->ext.buttons &= not_btn; // simulate a release event
-
-                    }
-
-                } else // if no turbo action, just copy the real button state
-                    xpad.fake_hold.set(idx, status->ext.buttons & btn);
+        if (map.active) [[unlikely]]
+            buttons = map.apply(buttons);
+    }
 
-            }
 
+    // Replace the buttons by their remaps; the "buttons" field is remapped as core buttons,
+    // unless a nunchuk is attached.
+    void
+    remap_buttons(WPADStatus* status,
+                  const snapshot::config& conf)
+        noexcept
+    {
+        switch (status->extensionType) {
+        case WPAD_EXT_CORE:
+        case WPAD_EXT_MPLUS:
+            apply_remap(conf.get_remap(notify::pad::wpad_core), status->buttons);
+            break;
+        case WPAD_EXT_NUNCHUK:
+        case WPAD_EXT_MPLUS_NUNCHUK:
+            apply_remap(conf.get_remap(notify::pad::wpad_nunchuk), status->buttons);
+            break;
+        case WPAD_EXT_CLASSIC:
+        case WPAD_EXT_MPLUS_CLASSIC:
+            apply_remap(conf.get_remap(notify::pad::wpad_core), status->buttons);
+            apply_remap(conf.get_remap(notify::pad::wpad_classic),
+                        reinterpret_cast<WPADClassicStatus*>(status)->ext.buttons);
+            break;
+        case WPAD_EXT_PRO_CONTROLLER:
+            apply_remap(conf.get_remap(notify::pad::wpad_pro),
+                        reinterpret_cast<WPADProStatus*>(status)->ext.buttons);
+            break;
         }
-
     }
 
 
+    // Process one sample.
     void
-    run_turbo_logic_ext(pad_state_t& pad,
-                        WPADProStatus* status,
-                        WPADChan channel)
+    process(pad_state_t& pad,
+            WPADStatus* status,
+            WPADChan channel,
+            const snapshot::config& conf)
+        noexcept
     {
-        auto& xpad = ensure<pro::pad_state_t>(pad.ext);
-        const auto& state = wups::utils::wpad::get_button_state(channel);
-        const auto& xstate = get<wups::utils::wpad::pro_button_state>(state.ext);
-
-        for (auto [idx, btn] : enumerate(pro::button_list)) {
-            const auto not_btn = ~uint32_t{btn};
-
-            // If this is a suppressed button, don't process it, keep it clear and
-            // skip further turbo processing.
-            if (xpad.suppress.test(idx)) {
-                // if the button is not held, or was released, we stop supressing it
-                if (!(xstate.hold & btn) || (xstate.release & btn))
-                    xpad.suppress.reset(idx);
-
-                status->ext.buttons &= not_btn;
-                continue;
-            }
-
-            if (pad.toggling && (xstate.trigger & btn)) {
-
-                // We're in the toggling state, and a button was triggered.
-                toggle_button(pad, xpad.turbo, idx, btn, channel);
-
-                // Hide this event from the game.
-                status->ext.buttons &= not_btn;
-
-                xpad.fake_hold.reset(idx);
-
-                // This button will be suppressed until a release event happens.
-                xpad.suppress.set(idx);
-
-                xpad.age[idx] = 0;
-
-            } else {
-
-                // We're not in the toggling state, just check if it's a turbinated button
-                // held down.
-
-                bool turbinated = xpad.turbo.test(idx);
-                if (turbinated && (xstate.hold & btn)) {
-
-                    if (++xpad.age[idx] >= cfg::period) {
-
-                        xpad.fake_hold.flip(idx);
-                        xpad.age[idx] = 0;
-
-                        if (xpad.fake_hold.test(idx))
-                            status->ext.buttons |= btn; // simulate a press event
-                        else
-                            status->ext.buttons &= not_btn; // simulate a release event
+        pad.update_ext_type(status->extensionType);
 
-                    }
+        // The capture gets the buttons as read from the controller.
+        const uint32_t raw_core = status->buttons;
+        const uint32_t raw_ext  = get_ext_buttons(status);
 
-                } else // if no turbo action, just copy the real button state
-                    xpad.fake_hold.set(idx, status->ext.buttons & btn);
+        // Note: everything after this sees the remapped buttons, like the game does.
+        remap_buttons(status, conf);
 
-            }
-
-        } // for each possible button
-
-    }
-
-
-    void
-    run_turbo_logic(pad_state_t& pad,
-                    WPADStatus* status,
-                    WPADChan channel)
-    {
+        auto core = turbo::track(pad.real_core, status->buttons);
+        turbo::edges ext;
         switch (status->extensionType) {
         case WPAD_EXT_CORE:
         case WPAD_EXT_MPLUS:
-            pad.ext = {};
-            run_turbo_logic_core(pad, status, channel);
-            break;
         case WPAD_EXT_NUNCHUK:
         case WPAD_EXT_MPLUS_NUNCHUK:
-            run_turbo_logic_core(pad, status, channel);
-            run_turbo_logic_ext(pad,
-                                reinterpret_cast<WPADNunchukStatus*>(status),
-                                channel);
             break;
         case WPAD_EXT_CLASSIC:
         case WPAD_EXT_MPLUS_CLASSIC:
-            run_turbo_logic_core(pad, status, channel);
-            run_turbo_logic_ext(pad,
-                                reinterpret_cast<WPADClassicStatus*>(status),
-                                channel);
+            ext = turbo::track(pad.real_ext,
+                               reinterpret_cast<WPADClassicStatus*>(status)->ext.buttons);
             break;
         case WPAD_EXT_PRO_CONTROLLER:
-            run_turbo_logic_ext(pad,
-                                reinterpret_cast<WPADProStatus*>(status),
-                                channel);
+            ext = turbo::track(pad.real_ext,
+                               reinterpret_cast<WPADProStatus*>(status)->ext.buttons);
             break;
+        default:
+            // Unknown extension, leave it alone.
+            return;
+        }
+
+        auto& tape = tapes[channel];
+
+        // Note: when a combo is activated, don't do any turbo processing.
+        const auto action = combo_triggered(status->extensionType, core, ext, conf);
+        if (action != combo::action::none) [[unlikely]] {
+
+            if (action == combo::action::toggle) {
+                // Enter or leave toggling state.
+                pad.toggling = !pad.toggling;
+
+                notify::post({
+                        .source  = notify::pad::wpad_core,
+                        .kind    = pad.toggling
+                                   ? notify::what::toggling
+                                   : notify::what::canceled,
+                        .channel = static_cast<std::uint8_t>(channel),
+                        .button  = 0
+                    });
+                trace::record(pad.toggling ? trace::kind::toggling : trace::kind::canceled,
+                              notify::pad::wpad_core, channel);
+                publish(pad, channel);
+            } else
+                macro::on_combo(tape, action, notify::pad::wpad_core, channel,
+                                status->extensionType);
+
+            // Discard buttons being held down, mark them as suppressed.
+            pad.clear_and_suppress_buttons(status);
+
+        } else [[likely]] {
+            bool played_out = false;
+            if (!tape.idle()) [[unlikely]]
+                played_out = run_macro(pad, tape, status, channel, core, ext);
+            run_turbo_logic(pad, status, channel, core, ext, conf);
+            // The real buttons are back on the next sample; the ones held now were never
+            // seen pressed, so they're suppressed until released.
+            if (played_out) [[unlikely]]
+                pad.suppress_held(status->extensionType, pad.real_core, pad.real_ext);
         }
+
+        if (conf.capture) [[unlikely]]
+            capture::push(notify::pad::wpad_core, channel,
+                          {
+                              static_cast<uint32_t>(OSGetSystemTick()),
+                              raw_core,
+                              raw_ext,
+                              status->buttons,
+                              get_ext_buttons(status),
+                              family_of(status->extensionType),
+                              true,
+                              false
+                          });
     }
 
 
@@ -652,50 +665,78 @@ namespace wpad {
                   WPADRead,
                   WPADChan channel,
                   WPADStatus* status)
+        noexcept
     {
         real_WPADRead(channel, status);
-        if (!cfg::enabled)
-            return;
         if (!status) [[unlikely]]
             return;
         if (channel < 0 || channel >= pads.size()) [[unlikely]]
             return;
+        if (status->error)
+            return;
 
-        if (!wups::utils::wpad::update(channel, status))
+        if (!hook_active.load(std::memory_order_relaxed))
             return;
 
-        auto& pad = pads[channel];
+        // If another thread is reading this channel right now, leave this sample alone.
+        auto& busy = channels[channel].busy;
+        // Note: seq_cst, so the config snapshot can be read; see snapshot::get().
+        if (busy.test_and_set(std::memory_order_seq_cst)) [[unlikely]]
+            return;
 
-        bool combo_activated = false;
-        for (const auto& combo : cfg::toggle_combo)
-            if (wups::utils::wpad::triggered(channel, combo)) {
-                combo_activated = true;
-                break;
-            }
+        // Note: seq_cst, so remove_hook() either sees busy set, or this sees it inactive.
+        const auto& conf = snapshot::get();
+        if (!hook_active.load(std::memory_order_seq_cst) || !conf.enabled) [[unlikely]] {
+            busy.clear(std::memory_order_release);
+            return;
+        }
 
-        // Note: when a combo is activated, don't do any turbo processing.
-        if (combo_activated) [[unlikely]] {
+        auto& ran = channels[channel].ran;
+        if (!ran.load(std::memory_order_relaxed)) [[unlikely]]
+            ran.store(true, std::memory_order_relaxed);
 
-            // Enter or leave toggling state.
-            pad.toggling = !pad.toggling;
+        // Note: the time is measured from here, so real_WPADRead() is not included.
+        const uint32_t start = OSGetSystemTick();
 
-            notify::info(pad.toggling
-                         ? "Toggling turbo..."
-                         : "Canceled turbo toggle.");
+        auto& pad = pads[channel];
+        apply_requests(pad, channel);
 
-            // Discard buttons being held down, mark them as suppressed.
-            pad.clear_and_suppress_buttons(status);
+        auto& dog = watchdogs[channel];
+        switch (dog.admit(start)) {
+        case watchdog::verdict::run:
+            break;
+        case watchdog::verdict::skip:
+            stats::channel::bump(counters[channel].skipped);
+            busy.clear(std::memory_order_release);
+            return;
+        case watchdog::verdict::resume:
+            resume(pad, channel);
+            publish(pad, channel);
+            break;
+        }
 
-        } else [[likely]]
-            try {
-                run_turbo_logic(pad, status, channel);
-            }
-            catch (std::exception& e) {
-                logger::printf("Error running WPAD turbo logic: %s\n", e.what());
-            }
+        process(pad, status, channel, conf);
+
+        const uint32_t now = OSGetSystemTick();
+        const uint32_t elapsed = now - start;
+        counters[channel].add_call(elapsed, 1);
+        const auto source = family_of(status->extensionType);
+        switch (dog.check(elapsed, conf.budget, now)) {
+        case watchdog::event::none:
+            break;
+        case watchdog::event::degraded:
+            stats::channel::bump(counters[channel].degraded);
+            trace::record(trace::kind::degraded, source, channel, elapsed);
+            break;
+        case watchdog::event::restored:
+            trace::record(trace::kind::restored, source, channel);
+            break;
+        }
+
+        busy.clear(std::memory_order_release);
     }
 
 
-    WUPS_MUST_REPLACE(WPADRead, WUPS_LOADER_LIBRARY_PADSCORE, WPADRead);
+    hooks::patch hook{REPLACE_FUNCTION(WPADRead, LIBRARY_PADSCORE, WPADRead)};
 
 } // namespace wpad
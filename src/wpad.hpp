@@ -9,10 +9,57 @@
 #ifndef WPAD_HPP
 #define WPAD_HPP
 
+#include <cstdint>
+
+
+namespace stats {
+    struct channel;
+}
+
+
 namespace wpad {
 
+    inline constexpr unsigned max_wpads = 7;
+
+
+    // Turbo buttons of one channel, for each kind of controller.
+    struct turbo_set {
+        std::uint16_t core    = 0;
+        std::uint16_t nunchuk = 0;
+        std::uint16_t classic = 0;
+        std::uint16_t pro     = 0;
+
+        bool operator ==(const turbo_set&) const noexcept = default;
+    };
+
+
     void reset();
 
+    // Whether the hook processed any sample since the last reset().
+    bool hook_ran() noexcept;
+
+    // Note: the channel must be below max_wpads.
+
+    // Turbo buttons of one channel, as last published by the hook, or as given to
+    // set_turbo() if the hook hasn't picked them up yet.
+    turbo_set get_turbo(unsigned channel) noexcept;
+
+    // Replace the turbo buttons of one channel; the hook does it on its next sample.
+    void set_turbo(unsigned channel, const turbo_set& buttons) noexcept;
+
+    // Counters kept by the hook for one channel.
+    const stats::channel& get_stats(unsigned channel) noexcept;
+
+    // Wait until every hook that is running right now returns.
+    void synchronize();
+
+    // Activate the WPADRead hook, installing it the first time, or deactivate it, depending
+    // on whether it's needed.
+    void update_hook();
+
+    // Deactivate the hook, wait for it to return, and remove it; only when the title ends.
+    void remove_hook();
+
 } // namespace wpad
 
 #endif
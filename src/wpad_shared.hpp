@@ -0,0 +1,165 @@
+/*
+ * Turbiine - Turn any controller into a turbo controller.
+ *
+ * Copyright (C) 2024  Daniel K. O.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef WPAD_SHARED_HPP
+#define WPAD_SHARED_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <padscore/wpad.h>
+
+#include "wpad.hpp"
+
+#include "hooks.hpp"
+#include "lockfree.hpp"
+#include "stats.hpp"
+#include "turbo.hpp"
+
+
+/*
+ * The WPADRead() hook is built without exceptions (see Makefile.am), so only the hook is
+ * in wpad.cpp; everything other threads call is in wpad_control.cpp, built normally. This
+ * is what they share.
+ */
+
+namespace wpad {
+
+    namespace core {
+
+        inline constexpr std::array button_list = {
+            WPAD_BUTTON_LEFT,
+            WPAD_BUTTON_RIGHT,
+            WPAD_BUTTON_DOWN,
+            WPAD_BUTTON_UP,
+            WPAD_BUTTON_PLUS,
+            WPAD_BUTTON_2,
+            WPAD_BUTTON_1,
+            WPAD_BUTTON_B,
+            WPAD_BUTTON_A,
+            WPAD_BUTTON_MINUS,
+        };
+
+        using kernel = turbo::kernel<button_list>;
+
+        using pad_state_t = kernel::state;
+
+    } // namespace core
+
+
+    namespace nunchuk {
+
+        inline constexpr std::array button_list = {
+            WPAD_NUNCHUK_BUTTON_Z,
+            WPAD_NUNCHUK_BUTTON_C,
+        };
+
+        using kernel = turbo::kernel<button_list>;
+
+        using pad_state_t = kernel::state;
+
+    } // namespace nunchuk
+
+
+    namespace classic {
+
+        inline constexpr std::array button_list = {
+            WPAD_CLASSIC_BUTTON_UP,
+            WPAD_CLASSIC_BUTTON_LEFT,
+            WPAD_CLASSIC_BUTTON_ZR,
+            WPAD_CLASSIC_BUTTON_X,
+            WPAD_CLASSIC_BUTTON_A,
+            WPAD_CLASSIC_BUTTON_Y,
+            WPAD_CLASSIC_BUTTON_B,
+            WPAD_CLASSIC_BUTTON_ZL,
+            WPAD_CLASSIC_BUTTON_R,
+            WPAD_CLASSIC_BUTTON_PLUS,
+            WPAD_CLASSIC_BUTTON_MINUS,
+            WPAD_CLASSIC_BUTTON_L,
+            WPAD_CLASSIC_BUTTON_DOWN,
+            WPAD_CLASSIC_BUTTON_RIGHT,
+        };
+
+        using kernel = turbo::kernel<button_list>;
+
+        using pad_state_t = kernel::state;
+
+    } // namespace classic
+
+
+    namespace pro {
+
+        inline constexpr std::array button_list = {
+            WPAD_PRO_BUTTON_UP,
+            WPAD_PRO_BUTTON_LEFT,
+            WPAD_PRO_TRIGGER_ZR,
+            WPAD_PRO_BUTTON_X,
+            WPAD_PRO_BUTTON_A,
+            WPAD_PRO_BUTTON_Y,
+            WPAD_PRO_BUTTON_B,
+            WPAD_PRO_TRIGGER_ZL,
+            WPAD_PRO_TRIGGER_R,
+            WPAD_PRO_BUTTON_PLUS,
+            WPAD_PRO_BUTTON_MINUS,
+            WPAD_PRO_TRIGGER_L,
+            WPAD_PRO_BUTTON_DOWN,
+            WPAD_PRO_BUTTON_RIGHT,
+        };
+
+        using kernel = turbo::kernel<button_list>;
+
+        using pad_state_t = kernel::state;
+
+    } // namespace pro
+
+
+    static_assert(sizeof(core::kernel::mask_type)    == sizeof(std::uint16_t));
+    static_assert(sizeof(nunchuk::kernel::mask_type) == sizeof(std::uint16_t));
+    static_assert(sizeof(classic::kernel::mask_type) == sizeof(std::uint16_t));
+    static_assert(sizeof(pro::kernel::mask_type)     == sizeof(std::uint16_t));
+
+
+    // What other threads can know about a channel.
+    struct summary_t {
+        turbo_set turbo;
+        bool      toggling = false;
+    };
+
+
+    // The part of a channel that is shared with other threads.
+    struct channel_t {
+        std::atomic_flag busy; // a hook is processing this channel
+        std::atomic<bool> ran = false; // the hook processed a sample since the last reset()
+        lockfree::seqlock<summary_t> summary;
+        // Turbo buttons set by set_turbo(), waiting for the hook.
+        std::atomic<std::uint16_t> loaded_core    = 0;
+        std::atomic<std::uint16_t> loaded_nunchuk = 0;
+        std::atomic<std::uint16_t> loaded_classic = 0;
+        std::atomic<std::uint16_t> loaded_pro     = 0;
+        std::atomic<bool>          load_pending   = false;
+    };
+
+
+    extern std::array<channel_t, max_wpads> channels;
+
+    extern lockfree::request reset_request;  // forget everything
+    extern lockfree::request resume_request; // the hook was idle, forget all but the turbos
+
+    // The hook stays installed while the title runs, but only does something while this is
+    // set; see update_hook().
+    extern std::atomic<bool> hook_active;
+
+    // Only the hook writes to these.
+    extern std::array<stats::channel, max_wpads> counters;
+
+    extern hooks::patch hook;
+
+} // namespace wpad
+
+#endif